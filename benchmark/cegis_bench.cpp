@@ -0,0 +1,400 @@
+//
+// Created by marcel on 16.10.26.
+//
+
+#include "CEGIS.h"
+#include "CEGISScheduler.h"
+#include <functional>
+#include <cstring>
+#include <cstdlib>
+
+/**
+ * Benchmark driver running parameterized synthesis families through the CEGIS routine and, as a baseline, through
+ * the monolithic exists/forall formulation. Every run results in a CSV line of the form
+ * Benchmark, Result, #Counter-examples, Runtime
+ */
+
+/**
+ * A synthesis task split in the parts expected by CEGISHandler.
+ */
+struct Instance {
+    std::string name;
+    z3::expr_vector impl, inp, hlp;
+    z3::expr implExpr, behavExpr, corrExpr;
+    /**
+     * Groups of inputs the correctness constraints are symmetric in.
+     */
+    std::vector<z3::expr_vector> symmetry;
+
+    Instance(z3::context & c, const std::string & n)
+            :
+            name{n},
+            impl{c}, inp{c}, hlp{c},
+            implExpr{c.bool_val(true)}, behavExpr{c.bool_val(true)}, corrExpr{c.bool_val(true)},
+            symmetry{}
+    {}
+};
+
+/**
+ * A family of synthesis tasks parameterized by a size.
+ */
+struct Family {
+    std::string name;
+    std::vector<unsigned> sizes;
+    std::function<Instance(z3::context &, unsigned)> build;
+};
+
+/**
+ * Number of bits needed to represent all values in [0, n).
+ */
+static unsigned bitsFor(unsigned n)
+{
+    unsigned b = 1;
+    while ((1u << b) < n)
+        ++b;
+    return b;
+}
+
+/**
+ * Exact synthesis of the n-input parity function with n - 1 two-input gates. Each gate selects two predecessors
+ * (primary inputs or earlier gates) and an arbitrary 2-input Boolean function given by its truth table.
+ */
+static Instance exactParity(z3::context & c, unsigned n)
+{
+    Instance inst{c, "exact-parity-" + std::to_string(n)};
+    const unsigned k = n - 1, w = bitsFor(n + k);
+
+    std::vector<z3::expr> nodes;
+    z3::expr parity = c.bool_val(false);
+    for (auto i = 0u; i < n; ++i)
+    {
+        auto x = c.bool_const(("x" + std::to_string(i)).c_str());
+        inst.inp.push_back(x);
+        nodes.push_back(x);
+        parity = parity != x;
+    }
+
+    z3::expr_vector implCons{c}, behavCons{c};
+    for (auto j = 0u; j < k; ++j)
+    {
+        const std::string id = std::to_string(j);
+        auto s1 = c.bv_const(("s1_" + id).c_str(), w), s2 = c.bv_const(("s2_" + id).c_str(), w);
+        inst.impl.push_back(s1);
+        inst.impl.push_back(s2);
+        std::vector<z3::expr> f;
+        for (auto m = 0u; m < 4; ++m)
+        {
+            f.push_back(c.bool_const(("f" + std::to_string(m) + "_" + id).c_str()));
+            inst.impl.push_back(f.back());
+        }
+        implCons.push_back(z3::ult(s1, s2) && z3::ult(s2, c.bv_val(n + j, w)));
+
+        z3::expr a = nodes.front(), b = nodes.front();
+        for (auto t = 1u; t < nodes.size(); ++t)
+        {
+            a = z3::ite(s1 == c.bv_val(t, w), nodes[t], a);
+            b = z3::ite(s2 == c.bv_val(t, w), nodes[t], b);
+        }
+
+        auto g = c.bool_const(("g" + id).c_str());
+        inst.hlp.push_back(g);
+        behavCons.push_back(g == z3::ite(a, z3::ite(b, f[3], f[2]), z3::ite(b, f[1], f[0])));
+        nodes.push_back(g);
+    }
+
+    inst.implExpr = z3::mk_and(implCons);
+    inst.behavExpr = z3::mk_and(behavCons);
+    inst.corrExpr = nodes.back() == parity;
+    inst.symmetry.push_back(inst.inp);
+    return inst;
+}
+
+/**
+ * Bit-vector program sketch of width w: find a shift amount and an offset such that ((x << s) + x) + k equals
+ * x * 5 + 3 for all x.
+ */
+static Instance bvSketch(z3::context & c, unsigned w)
+{
+    Instance inst{c, "bvsketch-" + std::to_string(w)};
+    auto s = c.bv_const("s", w), k = c.bv_const("k", w), x = c.bv_const("x", w), h = c.bv_const("h", w);
+    inst.impl.push_back(s);
+    inst.impl.push_back(k);
+    inst.inp.push_back(x);
+    inst.hlp.push_back(h);
+
+    inst.implExpr = z3::ult(s, c.bv_val(w, w));
+    inst.behavExpr = h == z3::shl(x, s) + x + k;
+    inst.corrExpr = h == x * c.bv_val(5, w) + c.bv_val(3, w);
+    return inst;
+}
+
+/**
+ * Ripple-carry adder of width w built from programmable 3-input lookup tables for sum and carry of every bit
+ * position. The tables have to be chosen such that the circuit is equivalent to bit-vector addition.
+ */
+static Instance adder(z3::context & c, unsigned w)
+{
+    Instance inst{c, "adder-" + std::to_string(w)};
+    auto x = c.bv_const("x", w), y = c.bv_const("y", w);
+    inst.inp.push_back(x);
+    inst.inp.push_back(y);
+
+    auto lut = [&](const z3::expr & table, const z3::expr & index)
+    {
+        return z3::lshr(table, z3::zext(index, 5)).extract(0, 0);
+    };
+
+    z3::expr_vector behavCons{c};
+    auto carry = c.bv_const("c0", 1);
+    inst.hlp.push_back(carry);
+    behavCons.push_back(carry == c.bv_val(0, 1));
+
+    z3::expr sum{c};
+    for (auto i = 0u; i < w; ++i)
+    {
+        const std::string id = std::to_string(i);
+        auto ls = c.bv_const(("ls" + id).c_str(), 8), lc = c.bv_const(("lc" + id).c_str(), 8);
+        inst.impl.push_back(ls);
+        inst.impl.push_back(lc);
+
+        auto s = c.bv_const(("s" + id).c_str(), 1), next = c.bv_const(("c" + std::to_string(i + 1)).c_str(), 1);
+        inst.hlp.push_back(s);
+        inst.hlp.push_back(next);
+
+        auto index = z3::concat(z3::concat(x.extract(i, i), y.extract(i, i)), carry);
+        behavCons.push_back(s == lut(ls, index));
+        behavCons.push_back(next == lut(lc, index));
+
+        sum = i == 0 ? s : z3::concat(s, sum);
+        carry = next;
+    }
+
+    inst.behavExpr = z3::mk_and(behavCons);
+    inst.corrExpr = sum == x + y;
+    inst.symmetry.push_back(inst.inp);
+    return inst;
+}
+
+/**
+ * Shift-and-add multiplier of width w where the shift amount of every partial product is unknown. The shift
+ * amounts have to be chosen such that the circuit is equivalent to bit-vector multiplication.
+ */
+static Instance multiplier(z3::context & c, unsigned w)
+{
+    Instance inst{c, "multiplier-" + std::to_string(w)};
+    auto x = c.bv_const("x", w), y = c.bv_const("y", w);
+    inst.inp.push_back(x);
+    inst.inp.push_back(y);
+
+    z3::expr_vector implCons{c}, behavCons{c};
+    auto acc = c.bv_const("acc0", w);
+    inst.hlp.push_back(acc);
+    behavCons.push_back(acc == c.bv_val(0, w));
+    for (auto i = 0u; i < w; ++i)
+    {
+        auto p = c.bv_const(("p" + std::to_string(i)).c_str(), w);
+        inst.impl.push_back(p);
+        implCons.push_back(z3::ult(p, c.bv_val(w, w)));
+
+        auto next = c.bv_const(("acc" + std::to_string(i + 1)).c_str(), w);
+        inst.hlp.push_back(next);
+        behavCons.push_back(next == acc + z3::ite(y.extract(i, i) == c.bv_val(1, 1), z3::shl(x, p), c.bv_val(0, w)));
+        acc = next;
+    }
+
+    inst.implExpr = z3::mk_and(implCons);
+    inst.behavExpr = z3::mk_and(behavCons);
+    inst.corrExpr = acc == x * y;
+    inst.symmetry.push_back(inst.inp);
+    return inst;
+}
+
+/**
+ * Solves the instance with the CEGIS routine and prints the result as a CSV line.
+ */
+static void runCEGIS(unsigned size, const Family & family, size_t lanes, size_t truthTables, size_t processes,
+                     const std::string & worker, bool pipeline, unsigned cubes, bool preprocess, bool symmetry,
+                     std::ostream & out)
+{
+    z3::context c;
+    auto inst = family.build(c, size);
+
+    CEGISHandler handler(&c, inst.impl, inst.inp, inst.hlp, inst.implExpr, inst.behavExpr, inst.corrExpr);
+    handler.setName(inst.name);
+    handler.setSimulation(lanes);
+    handler.setTruthTableThreshold(truthTables);
+    if (processes)
+        handler.setVerificationProcesses(processes, worker);
+    handler.setPipelining(pipeline);
+    handler.setCubeSharding(cubes);
+    handler.setPreprocessing(preprocess);
+    if (symmetry)
+        handler.setSymmetryGroups(inst.symmetry);
+    auto result = handler.CEGISRoutine();
+    result.print(out, true);
+}
+
+/**
+ * Solves the instance with a single solver call on exists impl: forall inp: exists hlp: constraints and prints
+ * the result as a CSV line.
+ */
+static void runMonolithic(unsigned size, const Family & family, unsigned timeout, std::ostream & out)
+{
+    z3::context c;
+    auto inst = family.build(c, size);
+
+    z3::expr inner = inst.behavExpr && inst.corrExpr;
+    if (!inst.hlp.empty())
+        inner = z3::exists(inst.hlp, inner);
+    z3::expr formula = inst.implExpr && z3::forall(inst.inp, inner);
+    if (!inst.impl.empty())
+        formula = z3::exists(inst.impl, formula);
+
+    z3::solver s{c};
+    z3::params p{c};
+    p.set("timeout", timeout);
+    s.set(p);
+    s.add(formula);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    auto result = s.check();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    out << inst.name << "-monolithic, " << result << ", " << 0 << ", "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << std::endl;
+}
+
+/**
+ * Runs the given number of tasks, cycling through the smallest size of every selected family, on CEGISScheduler
+ * pools of increasing size and prints one CSV line per pool size. The result is sat iff all tasks were solved and
+ * the number of counter examples is the sum over all tasks.
+ */
+static void runThroughput(const std::vector<const Family *> & families, unsigned tasks, std::ostream & out)
+{
+    const unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+    for (unsigned workers = 1; ; workers = std::min(workers * 2, cores))
+    {
+        CEGISScheduler scheduler{workers};
+        for (auto i = 0u; i < tasks; ++i)
+        {
+            const Family * family = families[i % families.size()];
+            scheduler.submit([family](z3::context & c)
+            {
+                auto inst = family->build(c, family->sizes.front());
+                std::unique_ptr<CEGISHandler> handler{new CEGISHandler(&c, inst.impl, inst.inp, inst.hlp,
+                                                                       inst.implExpr, inst.behavExpr,
+                                                                       inst.corrExpr)};
+                handler->setName(inst.name);
+                return handler;
+            });
+        }
+
+        bool solved = true;
+        size_t counterExamples = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        scheduler.run([&](const CEGISHandler::CEGISResult & result)
+        {
+            solved &= result.check() == z3::sat;
+            counterExamples += result.getNumberOfCounterExamples();
+        });
+        auto end = std::chrono::high_resolution_clock::now();
+
+        out << "throughput-" << tasks << "-tasks-" << workers << "-workers, " << (solved ? "sat" : "unknown") << ", "
+            << counterExamples << ", " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
+            << std::endl;
+
+        if (workers == cores)
+            break;
+    }
+}
+
+static void usage(const char * program)
+{
+    std::cerr << "Usage: " << program << " [--family NAME] [--max-size N] [--timeout MS] [--no-baseline]"
+              << " [--throughput TASKS] [--simulate LANES] [--truth-tables N] [--processes N] [--worker PATH]"
+              << " [--pipeline] [--cubes DEPTH] [--preprocess] [--symmetry]" << std::endl;
+    std::cerr << "Families: exact, bvsketch, adder, multiplier" << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+    std::string only{}, worker{"cegis_worker"};
+    unsigned maxSize = 0, timeout = 60000, throughput = 0, lanes = 0, truthTables = 16, processes = 0, cubes = 0;
+    bool baseline = true, pipeline = false, preprocess = false, symmetry = false;
+
+    for (auto i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "--family") && i + 1 < argc)
+            only = argv[++i];
+        else if (!std::strcmp(argv[i], "--max-size") && i + 1 < argc)
+            maxSize = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--timeout") && i + 1 < argc)
+            timeout = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--throughput") && i + 1 < argc)
+            throughput = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--simulate") && i + 1 < argc)
+            lanes = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--truth-tables") && i + 1 < argc)
+            truthTables = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--processes") && i + 1 < argc)
+            processes = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--worker") && i + 1 < argc)
+            worker = argv[++i];
+        else if (!std::strcmp(argv[i], "--cubes") && i + 1 < argc)
+            cubes = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--preprocess"))
+            preprocess = true;
+        else if (!std::strcmp(argv[i], "--symmetry"))
+            symmetry = true;
+        else if (!std::strcmp(argv[i], "--pipeline"))
+            pipeline = true;
+        else if (!std::strcmp(argv[i], "--no-baseline"))
+            baseline = false;
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    const std::vector<Family> families
+    {
+        {"exact",      {3, 4, 5},         exactParity},
+        {"bvsketch",   {8, 16, 32, 64},   bvSketch},
+        {"adder",      {4, 8, 16, 32},    adder},
+        {"multiplier", {4, 6, 8},         multiplier}
+    };
+
+    std::cout << "Benchmark, Result, #Counter-examples, Runtime" << std::endl;
+    if (throughput)
+    {
+        std::vector<const Family *> selected;
+        for (const auto & family : families)
+        {
+            if (only.empty() || only == family.name)
+                selected.push_back(&family);
+        }
+        if (!selected.empty())
+            runThroughput(selected, throughput, std::cout);
+        return 0;
+    }
+
+    for (const auto & family : families)
+    {
+        if (!only.empty() && only != family.name)
+            continue;
+
+        for (auto size : family.sizes)
+        {
+            if (maxSize && size > maxSize)
+                continue;
+
+            runCEGIS(size, family, lanes, truthTables, processes, worker, pipeline, cubes, preprocess, symmetry,
+                     std::cout);
+            if (baseline)
+                runMonolithic(size, family, timeout, std::cout);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,488 @@
+//
+// Created by marcel on 16.10.26.
+//
+
+#include "TaskFile.h"
+#include "Autotuner.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
+#include <cerrno>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+namespace
+{
+    /**
+     * Grace period in milliseconds granted to a task beyond its timeout before its worker is killed.
+     */
+    const long KILL_GRACE = 1000;
+
+    /**
+     * Additional address space in megabytes granted to a worker on top of the memory limit of its tasks.
+     */
+    const size_t ADDRESS_SPACE_SLACK = 512;
+
+    /**
+     * Settings shared by all tasks.
+     */
+    struct Options {
+        unsigned timeout = 0;
+        size_t memory = 0;
+        size_t jobs = 0;
+        bool csv = false;
+        bool model = false;
+        bool preprocess = false;
+        SolverProfile profile{};
+    };
+
+    /**
+     * Returns the file name of the given path without directory and extension.
+     */
+    std::string stem(const std::string & path)
+    {
+        auto base = path.substr(path.find_last_of('/') == std::string::npos ? 0 : path.find_last_of('/') + 1);
+        return base.substr(0, base.find_last_of('.'));
+    }
+
+    /**
+     * Returns a CSV line in the format of CEGISResult::print for a task that did not produce a result.
+     */
+    std::string failure(const std::string & path, const std::string & status, long ms)
+    {
+        return stem(path) + ", " + status + ", 0, " + std::to_string(ms) + "\n";
+    }
+
+    /**
+     * Appends the task files listed in the given manifest to tasks. Empty lines and lines starting with # are
+     * skipped, relative paths are resolved against the directory of the manifest.
+     */
+    bool readManifest(const std::string & manifest, std::vector<std::string> & tasks)
+    {
+        std::ifstream file{manifest};
+        if (!file)
+            return false;
+
+        const auto slash = manifest.find_last_of('/');
+        const auto dir = slash == std::string::npos ? std::string{} : manifest.substr(0, slash + 1);
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+            line.erase(0, line.find_first_not_of(" \t\r"));
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if (line.empty() || line.front() == '#')
+                continue;
+            tasks.push_back(line.front() == '/' ? line : dir + line);
+        }
+        return true;
+    }
+
+    /**
+     * Solves a single task in the given context and writes its result as a CSV line (or in human readable form) to
+     * out. Parse errors are reported to std::cerr and as a result line with status error.
+     */
+    void solve(z3::context & c, const std::string & path, const Options & opt, bool csv, std::ostream & out)
+    {
+        try
+        {
+            auto task = TaskFile::load(c, path);
+            auto handler = task.makeHandler();
+            handler->setSolverProfile(opt.profile);
+            handler->setPreprocessing(opt.preprocess);
+            handler->setTimeout(opt.timeout);
+            handler->setMemoryLimit(opt.memory);
+
+            auto result = handler->CEGISRoutine();
+            result.print(out, csv);
+            if (opt.model && result.getStopReason() == CEGISHandler::StopReason::SOLVED)
+            {
+                for (auto i = 0u; i < task.implementationVariables.size(); ++i)
+                    out << task.implementationVariables[i] << " = "
+                        << result.getValuation(task.implementationVariables[i], true) << std::endl;
+            }
+        }
+        catch (const z3::exception & e)
+        {
+            // Z3's parser errors span several lines
+            std::string message{e.msg()};
+            std::replace(message.begin(), message.end(), '\n', ' ');
+            message.erase(message.find_last_not_of(' ') + 1);
+            // e.g. unknown parameters are followed by the list of all legal ones
+            if (message.size() > 200)
+                message = message.substr(0, 200) + "...";
+            std::cerr << path << ": " << message << std::endl;
+            out << failure(path, "error", 0);
+        }
+    }
+
+    /**
+     * Writes the whole string to the given file descriptor.
+     */
+    bool writeAll(int fd, const std::string & s)
+    {
+        for (size_t sent = 0; sent < s.size();)
+        {
+            auto n = write(fd, s.data() + sent, s.size() - sent);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    /**
+     * Terminates each reply of a worker. A reply consists of the CSV line of a task followed by its model iff
+     * requested, hence it can not be delimited by a newline.
+     */
+    const char END_OF_REPLY = '\0';
+
+    /**
+     * Worker loop of the batch mode. Receives task indices line by line and answers each with its CSV line (and
+     * model) followed by END_OF_REPLY.
+     */
+    int serve(int fd, const std::vector<std::string> & tasks, const Options & opt)
+    {
+        if (opt.memory)
+        {
+            rlimit limit{};
+            limit.rlim_cur = limit.rlim_max = (opt.memory + ADDRESS_SPACE_SLACK) << 20u;
+            setrlimit(RLIMIT_AS, &limit);
+        }
+
+        // the context is reused across tasks, as creating one costs as much as solving a small task
+        z3::context c;
+        std::string buffer;
+        char chunk[256];
+        while (true)
+        {
+            auto newline = buffer.find('\n');
+            if (newline == std::string::npos)
+            {
+                auto n = read(fd, chunk, sizeof(chunk));
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    return 0;
+                buffer.append(chunk, static_cast<size_t>(n));
+                continue;
+            }
+
+            const auto index = std::strtoul(buffer.substr(0, newline).c_str(), nullptr, 10);
+            buffer.erase(0, newline + 1);
+
+            std::stringstream reply{};
+            solve(c, tasks[index], opt, true, reply);
+            reply << END_OF_REPLY;
+            if (!writeAll(fd, reply.str()))
+                return 1;
+        }
+    }
+
+    /**
+     * A worker process of the batch mode as seen by the driver.
+     */
+    struct Worker {
+        pid_t pid = 0;
+        int fd = -1;
+        /**
+         * Index of the running task. Equals the number of tasks iff the worker is idle.
+         */
+        size_t task = 0;
+        std::chrono::steady_clock::time_point start{};
+        std::string buffer{};
+    };
+
+    /**
+     * Forks a worker serving the given tasks.
+     */
+    bool spawn(Worker & w, const std::vector<std::string> & tasks, const Options & opt)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+            return false;
+
+        // the driver never creates a context, hence forking without exec is safe
+        std::cout.flush();
+        auto pid = fork();
+        if (pid < 0)
+        {
+            close(fds[0]);
+            close(fds[1]);
+            return false;
+        }
+        if (pid == 0)
+        {
+#ifdef __linux__
+            // do not outlive the driver with a long running task
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+            close(fds[0]);
+            _exit(serve(fds[1], tasks, opt));
+        }
+
+        close(fds[1]);
+        w.pid = pid;
+        w.fd = fds[0];
+        w.task = tasks.size();
+        w.buffer.clear();
+        return true;
+    }
+
+    /**
+     * Reaps the given worker, killing it first iff requested. Returns the signal that ended the worker, 0 iff it
+     * exited normally or was killed here.
+     */
+    int stop(Worker & w, bool force)
+    {
+        int status = 0;
+        if (w.fd >= 0)
+            close(w.fd);
+        if (w.pid > 0)
+        {
+            if (force)
+                kill(w.pid, SIGKILL);
+            waitpid(w.pid, &status, 0);
+        }
+        w.fd = -1;
+        w.pid = 0;
+        return !force && WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+    }
+
+    /**
+     * Runs all tasks on a pool of worker processes and streams their CSV lines (each followed by its model iff
+     * requested) to std::cout in completion order. Workers that crash, exceed their memory or overrun their timeout
+     * are replaced by fresh ones.
+     */
+    int runBatch(const std::vector<std::string> & tasks, const Options & opt)
+    {
+        std::signal(SIGPIPE, SIG_IGN);
+        const auto clockNow = [] { return std::chrono::steady_clock::now(); };
+        const auto elapsed = [&](const std::chrono::steady_clock::time_point & since)
+        {
+            return static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(clockNow() - since).count());
+        };
+
+        std::vector<Worker> workers(std::max(std::min(opt.jobs, tasks.size()), size_t{1}));
+        for (auto & w : workers)
+        {
+            if (!spawn(w, tasks, opt))
+            {
+                std::cerr << "cannot start worker processes" << std::endl;
+                return 1;
+            }
+        }
+
+        std::cout << "Benchmark, Result, #Counter-examples, Runtime" << std::endl;
+
+        size_t next = 0, done = 0;
+        while (done < tasks.size())
+        {
+            for (auto & w : workers)
+            {
+                if (w.task == tasks.size() && next < tasks.size())
+                {
+                    w.task = next++;
+                    w.start = clockNow();
+                    writeAll(w.fd, std::to_string(w.task) + "\n");
+                }
+            }
+
+            // wake up in time to kill the first worker overrunning its timeout
+            std::vector<pollfd> fds;
+            long wait = -1;
+            for (auto & w : workers)
+            {
+                fds.push_back({w.fd, POLLIN, 0});
+                if (opt.timeout && w.task != tasks.size())
+                {
+                    const auto left = std::max(static_cast<long>(opt.timeout) + KILL_GRACE - elapsed(w.start), 0l);
+                    wait = wait < 0 ? left : std::min(wait, left);
+                }
+            }
+            if (poll(fds.data(), fds.size(), static_cast<int>(wait)) < 0 && errno != EINTR)
+                return 1;
+
+            for (auto i = 0u; i < workers.size(); ++i)
+            {
+                auto & w = workers[i];
+                if (w.task == tasks.size())
+                    continue;
+
+                std::string status{};
+                if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+                {
+                    char chunk[4096];
+                    auto n = read(w.fd, chunk, sizeof(chunk));
+                    if (n > 0)
+                    {
+                        w.buffer.append(chunk, static_cast<size_t>(n));
+                        auto end = w.buffer.find(END_OF_REPLY);
+                        if (end != std::string::npos)
+                        {
+                            std::cout << w.buffer.substr(0, end) << std::flush;
+                            w.buffer.erase(0, end + 1);
+                            w.task = tasks.size();
+                            ++done;
+                        }
+                        continue;
+                    }
+                    if (n < 0 && errno == EINTR)
+                        continue;
+                    status = "error";
+                }
+                else if (opt.timeout && elapsed(w.start) > static_cast<long>(opt.timeout) + KILL_GRACE)
+                    status = "timeout";
+                else
+                    continue;
+
+                // the worker died or hangs, report its task and replace it
+                const auto ms = elapsed(w.start);
+                const auto signal = stop(w, status == "timeout");
+                // exceeding the address space limit ends in an uncaught std::bad_alloc
+                if (status == "error" && opt.memory && (signal == SIGABRT || signal == SIGKILL))
+                    status = "memout";
+                std::cout << failure(tasks[w.task], status, ms) << std::flush;
+                ++done;
+                if (!spawn(w, tasks, opt))
+                {
+                    std::cerr << "cannot restart a worker process" << std::endl;
+                    return 1;
+                }
+            }
+        }
+
+        for (auto & w : workers)
+            stop(w, true);
+        return 0;
+    }
+
+    /**
+     * Tunes the solver configurations on the given sample tasks and writes the best profile to the given file.
+     */
+    int runTuning(const std::vector<std::string> & tasks, const Options & opt, const std::string & path)
+    {
+        // unsolved tasks are penalized by twice the timeout, hence one is required
+        Autotuner tuner{opt.timeout ? opt.timeout : 10000};
+        for (const auto & task : tasks)
+        {
+            tuner.addTask([task](z3::context & c)
+            {
+                return TaskFile::load(c, task).makeHandler();
+            });
+        }
+
+        const auto profile = tuner.tune(&std::cerr);
+        std::ofstream file{path};
+        profile.save(file);
+        if (!file)
+        {
+            std::cerr << "cannot write " << path << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    void usage(const char * program)
+    {
+        std::cerr << "Usage: " << program << " [--timeout MS] [--memory MB] [--jobs N] [--csv] [--model]"
+                  << " [--preprocess] [--profile FILE] [--tune FILE] [--batch MANIFEST] [TASK...]" << std::endl;
+        std::cerr << "A single task is solved in process, several tasks (or a manifest listing one task file per"
+                  << " line) are distributed over N worker processes. --tune evaluates solver configurations on the"
+                  << " tasks and writes the best profile to FILE, which --profile loads." << std::endl;
+    }
+}
+
+/**
+ * Command-line driver solving synthesis tasks given as SMT-LIB2 task files (see TaskFile).
+ */
+int main(int argc, char * argv[])
+{
+    Options opt{};
+    std::vector<std::string> tasks{};
+    std::string tuning{};
+    bool batch = false;
+
+    for (auto i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "--timeout") && i + 1 < argc)
+            opt.timeout = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else if (!std::strcmp(argv[i], "--memory") && i + 1 < argc)
+            opt.memory = std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--jobs") && i + 1 < argc)
+            opt.jobs = std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--csv"))
+            opt.csv = true;
+        else if (!std::strcmp(argv[i], "--model"))
+            opt.model = true;
+        else if (!std::strcmp(argv[i], "--preprocess"))
+            opt.preprocess = true;
+        else if (!std::strcmp(argv[i], "--tune") && i + 1 < argc)
+            tuning = argv[++i];
+        else if (!std::strcmp(argv[i], "--profile") && i + 1 < argc)
+        {
+            std::ifstream file{argv[++i]};
+            try
+            {
+                opt.profile = SolverProfile::load(file);
+            }
+            catch (const z3::exception & e)
+            {
+                std::cerr << argv[i] << ": " << e.msg() << std::endl;
+                return 1;
+            }
+        }
+        else if (!std::strcmp(argv[i], "--batch") && i + 1 < argc)
+        {
+            batch = true;
+            if (!readManifest(argv[++i], tasks))
+            {
+                std::cerr << "cannot read " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (argv[i][0] == '-')
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        else
+            tasks.emplace_back(argv[i]);
+    }
+
+    if (tasks.empty() && !batch)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (!tuning.empty())
+        return runTuning(tasks, opt, tuning);
+
+    if (!batch && tasks.size() == 1)
+    {
+        z3::context c;
+        solve(c, tasks.front(), opt, opt.csv, std::cout);
+        return 0;
+    }
+
+    if (!opt.jobs)
+        opt.jobs = std::max(std::thread::hardware_concurrency(), 1u);
+    return runBatch(tasks, opt);
+}
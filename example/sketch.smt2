@@ -0,0 +1,8 @@
+; find k such that x * k == (x << 3) + x for all x
+(set-info :name sketch-8)
+(declare-const k (_ BitVec 8))
+(declare-const x (_ BitVec 8))
+(set-info :cegis-implementation-variables (k))
+(set-info :cegis-input-variables (x))
+(define-fun spec ((a (_ BitVec 8))) (_ BitVec 8) (bvadd (bvshl a #x03) a))
+(define-fun correctness () Bool (= (bvmul x k) (spec x)))
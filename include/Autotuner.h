@@ -0,0 +1,98 @@
+//
+// Created by marcel on 16.10.26.
+//
+
+#ifndef CEGIS_AUTOTUNER_H
+#define CEGIS_AUTOTUNER_H
+
+#include <vector>
+#include <functional>
+#include <memory>
+#include <iostream>
+#include "CEGIS.h"
+#include "SolverProfile.h"
+
+/**
+ * Offline tuner searching the best solver configuration per role for a sample of tasks. Every candidate
+ * configuration of a role is evaluated on all sample tasks, which are solved one after another so that the
+ * measured runtimes do not interfere. Candidates are scored by their PAR-2 runtime, i.e. the sum of all runtimes
+ * where unsolved tasks count twice the timeout. A candidate is dropped as soon as its partial score exceeds the
+ * best complete one.
+ *
+ * The roles are tuned one after another: first the implementation solver with the default counter example
+ * solver, then the counter example solver with the best implementation solver.
+ */
+class Autotuner {
+
+public:
+    /**
+     * A sample task. Gets a fresh context and has to create all variables, constraints and the handler within it.
+     * The solver configurations and the timeout of the handler are set by the tuner.
+     */
+    using Task = std::function<std::unique_ptr<CEGISHandler>(z3::context &)>;
+
+private:
+    /**
+     * The sample tasks.
+     */
+    std::vector<Task> tasks;
+    /**
+     * Timeout per task and candidate in milliseconds.
+     */
+    const unsigned timeout;
+    /**
+     * Candidate configurations of the implementation and the counter example solver.
+     */
+    std::vector<SolverConfiguration> candidates[2];
+
+    /**
+     * Solves all sample tasks under the given profile and returns its PAR-2 score.
+     *
+     * @param profile The profile to be evaluated.
+     * @param bound Score from which on the evaluation is stopped.
+     * @return The score in milliseconds, at least bound iff the evaluation was stopped.
+     */
+    long evaluate(const SolverProfile & profile, long bound) const;
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param timeout Timeout per task and candidate in milliseconds.
+     */
+    explicit Autotuner(unsigned timeout);
+
+    /**
+     * Adds a sample task.
+     *
+     * @param task The task.
+     */
+    void addTask(const Task & task);
+
+    /**
+     * Adds a candidate configuration for the given role. If no candidates are added for a role,
+     * defaultCandidates() are used.
+     *
+     * @param role The role.
+     * @param config The candidate.
+     */
+    void addCandidate(SolverRole role, const SolverConfiguration & config);
+
+    /**
+     * Returns candidates suitable for QF_BV and QF_FD specifications: the default solver, Z3's QF_BV and QF_FD
+     * strategies and bit-blasting pipelines with different SAT parameters.
+     *
+     * @return The candidates.
+     */
+    static std::vector<SolverConfiguration> defaultCandidates();
+
+    /**
+     * Tunes both roles on the sample tasks.
+     *
+     * @param log Receives the score of every candidate iff not null.
+     * @return The best profile found.
+     */
+    SolverProfile tune(std::ostream * log = nullptr) const;
+};
+
+#endif //CEGIS_AUTOTUNER_H
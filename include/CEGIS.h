@@ -7,15 +7,116 @@
 
 #include <iostream>
 #include <chrono>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <future>
+#include <unordered_map>
+#include <unordered_set>
 #include <boost/optional.hpp>
-#include <boost/format.hpp>
 #include <z3++.h>
+#include "SolverPortfolio.h"
+#include "ProcessPortfolio.h"
+#include "Simulator.h"
+#include "SolverProfile.h"
 
 /**
  * Handler for Counter Example Guided Inductive Synthesis (CEGIS) routine for the SMT solver z3.
  */
 class CEGISHandler {
 
+public:
+    /**
+     * Reasons for the CEGIS routine to stop.
+     */
+    enum class StopReason {
+        /**
+         * A correct implementation was found.
+         */
+        SOLVED,
+        /**
+         * No implementation is possible.
+         */
+        UNREALIZABLE,
+        /**
+         * The solvers were not able to reason about the instance.
+         */
+        UNKNOWN,
+        /**
+         * The wall-clock deadline passed.
+         */
+        TIMEOUT,
+        /**
+         * The maximum number of counter examples was reached.
+         */
+        COUNTER_EXAMPLE_LIMIT,
+        /**
+         * Z3's memory consumption exceeded the ceiling.
+         */
+        MEMORY_LIMIT,
+        /**
+         * The routine was stopped via cancel().
+         */
+        CANCELLED,
+        /**
+         * The task failed with an exception, e.g. while creating its handler (see CEGISScheduler).
+         */
+        ERROR
+    };
+
+    /**
+     * Strategies to tighten the cost bound in minimize().
+     */
+    enum class CostSearch {
+        /**
+         * Each bound is one less than the cost of the best implementation found so far.
+         */
+        LINEAR,
+        /**
+         * Bisects the range between the lowest cost not yet ruled out and the best cost found so far. Without a
+         * known lower bound, the distance to the best cost is doubled until a bound turns out to be infeasible.
+         */
+        BINARY
+    };
+
+    /**
+     * Means by which an implementation was verified, i.e. which one delivered the verdict.
+     */
+    enum class Verifier {
+        /**
+         * No implementation was verified.
+         */
+        NONE,
+        /**
+         * The counter example solver.
+         */
+        SOLVER,
+        /**
+         * The counter example portfolio racing on the whole input space.
+         */
+        PORTFOLIO,
+        /**
+         * The counter example portfolio solving cubes of the input space.
+         */
+        CUBES,
+        /**
+         * The verification worker processes.
+         */
+        PROCESSES,
+        /**
+         * The verification thread of the pipeline.
+         */
+        PIPELINE,
+        /**
+         * Simulation of the implementation on random inputs.
+         */
+        SIMULATION,
+        /**
+         * Simulation of the implementation on all inputs.
+         */
+        TRUTH_TABLES
+    };
+
 private:
     /**
      * A class representing an implementation, i.e. a valuation to the implementation variables.
@@ -47,63 +148,185 @@ private:
         const z3::expr extractConstraints(const z3::expr_vector & implVars,
                                                 z3::context     * ctx) const;
         /**
-         * Returns the valuation to the given variable. Returns the variable itself iff no valuation exists.
+         * Like extractConstraints() but splits the valuation into its finest parts, i.e. one equality per bit
+         * for bit-vector variables and one equality per variable otherwise. The conjunction of the returned
+         * constraints equals the result of extractConstraints().
+         *
+         * @param implVars The variables for which the valuation is sought.
+         * @return Constraints forcing single bits or variables of implVars to have their value in the model.
+         */
+        const z3::expr_vector extractBitConstraints(const z3::expr_vector & implVars,
+                                                          z3::context     * ctx) const;
+        /**
+         * Returns the valuation to the given variable. Returns the variable itself iff no valuation exists and
+         * completion is not requested.
          *
+         * @param completion Flag indicating whether a value should be assigned to variables without valuation.
          * @return The valuation to the given (implementation) variables.
          */
-        const z3::expr getValuation(z3::expr var) const;
+        const z3::expr getValuation(z3::expr var, bool completion = false) const;
     }; // Implementation
 
     /**
-     * Class representing a counter example within the CEGIS routine, i.e. a valuation to the input variables
-     * so that the current implementation works incorrectly.
+     * Compact storage of the input valuations of all counter examples of a handler. Values are kept in a dense
+     * arena of 64 bit words, a fixed number of words per counter example, indexed by input position. Boolean and
+     * bit-vector values are stored as (little-endian) words, values of other sorts as numerals referenced by their
+     * index. Numerals are only created on demand.
      */
-    class CounterExample {
+    class CounterExampleStore {
 
     private:
         /**
-         * The given model to store the valuation.
+         * The input variables in the order of their positions.
          */
-        const z3::model model;
+        const z3::expr_vector inputs;
+        /**
+         * Offset of the first word of each input within a counter example.
+         */
+        std::vector<size_t> offsets;
         /**
-         * A serial number.
+         * Number of words per counter example.
          */
-        const size_t id;
+        size_t stride = 0;
+        /**
+         * The arena holding the values of all counter examples.
+         */
+        std::vector<uint64_t> words;
+        /**
+         * Values of inputs that are neither Boolean nor bit-vectors.
+         */
+        z3::expr_vector numerals;
 
     public:
         /**
-         * Constructor of the CounterExample. Takes a model to store the current valuation determined by
-         * the counterExampleSolver.
+         * Constructor. Determines the layout for the given input variables.
+         *
+         * @param inputVars The input variables.
+         */
+        explicit CounterExampleStore(const z3::expr_vector & inputVars);
+
+        /**
+         * Appends the valuation of the input variables in the given model. Variables without valuation are
+         * completed by Z3.
          *
          * @param mdl A model representing the counter example valuation.
+         * @return The index of the stored counter example.
          */
-        CounterExample(const z3::model & mdl);
+        size_t add(const z3::model & mdl);
+
+        /**
+         * Appends a copy of a counter example of the given store, which has to be laid out for the same inputs and
+         * may be this one. If sources is not empty, the values are permuted: input i takes the value of input
+         * sources[i], which has to be of the same sort.
+         *
+         * @param from The store holding the counter example.
+         * @param ce Index of the counter example within from.
+         * @param sources Source position of every input. Empty for an identical copy.
+         * @return The index of the stored counter example.
+         */
+        size_t add(const CounterExampleStore & from, size_t ce, const std::vector<size_t> & sources = {});
+
+        /**
+         * Compares the values of two Boolean or bit-vector inputs of the same sort of a stored counter example.
+         *
+         * @param ce Index of the counter example.
+         * @param a Position of the first input.
+         * @param b Position of the second input.
+         * @return true iff the value of a is less than the one of b, read as unsigned numbers.
+         */
+        bool less(size_t ce, size_t a, size_t b) const;
+
+        /**
+         * Returns a key identifying the valuation of a stored counter example, permuted as in add(), for hashing.
+         * Equal keys denote equal valuations.
+         *
+         * @param ce Index of the counter example.
+         * @param sources Source position of every input. Empty for the valuation itself.
+         * @return The key.
+         */
+        std::string key(size_t ce, const std::vector<size_t> & sources = {}) const;
+
+        /**
+         * Regenerates the value of an input of a stored counter example.
+         *
+         * @param ce Index of the counter example.
+         * @param input Position of the input variable.
+         * @return The value as a numeral.
+         */
+        const z3::expr getValue(size_t ce, size_t input) const;
+
+        /**
+         * Drops all counter examples from the given index on. Numerals they reference are kept.
+         *
+         * @param n The number of counter examples to keep.
+         */
+        void truncate(size_t n);
+
         /**
-         * Default copy constructor.
+         * Returns the number of stored counter examples.
          *
-         * @param ce CounterExample to be copied.
+         * @return The number of counter examples.
+         */
+        size_t size() const;
+    }; // CounterExampleStore
+
+    /**
+     * Class representing a counter example within the CEGIS routine, i.e. a valuation to the input variables
+     * so that the current implementation works incorrectly. A lightweight handle to the values kept in a
+     * CounterExampleStore.
+     */
+    class CounterExample {
+
+    private:
+        /**
+         * The store holding the valuation.
+         */
+        const CounterExampleStore * store;
+        /**
+         * A serial number, i.e. the index within the store.
          */
-        CounterExample(const CounterExample & ce) = default;
+        size_t id;
+
+    public:
         /**
-         * Move constructor.
+         * Constructor of the CounterExample. Refers to the valuation stored at the given index.
          *
-         * @param ce CounterExample to be moved.
+         * @param s The store holding the valuation.
+         * @param n The serial number of the counter example within its handler, i.e. its index in s.
          */
-        CounterExample(CounterExample && ce);
+        CounterExample(const CounterExampleStore & s, size_t n);
 
         /**
-         * Extracts constraints from the stored model concerning the input variables, i.e. extracts an expression
-         * stating that the given input variables should have the values they have in the model.
+         * Extracts constraints from the stored valuation, i.e. extracts an expression stating that the relabeled
+         * input variables should have the values of the counter example.
          *
-         * @param inputVars The variables for which the valuation is sought.
-         * @param templ A pattern to relabel the variables concerning to the actual counter example number.
-         * @return A constraint forcing relabeled inputVars to have the same valuation as they originally
-         *         had in the stored model.
+         * @param renamedVars The relabeled variables concerning to the actual counter example number. Entry i
+         *                    corresponds to input i, additional entries are ignored.
+         * @param inputs Number of input variables.
+         * @return A constraint forcing the relabeled inputs to have the stored valuation.
          */
-        const z3::expr extractConstraints(const z3::expr_vector & inputVars,
-                                                boost::format     templ,
+        const z3::expr extractConstraints(const z3::expr_vector & renamedVars,
+                                                size_t            inputs,
                                                 z3::context     * ctx) const;
 
+        /**
+         * Extracts a constraint excluding the stored valuation of the given input variables, i.e. an expression
+         * stating that at least one of them has to take another value.
+         *
+         * @param inputVars The variables whose valuation should be blocked.
+         * @return A constraint blocking the stored valuation of inputVars.
+         */
+        const z3::expr extractBlockingConstraint(const z3::expr_vector & inputVars,
+                                                       z3::context     * ctx) const;
+
+        /**
+         * Returns the value of the input variable at the given position.
+         *
+         * @param input Position of the input variable.
+         * @return The value of the input variable.
+         */
+        const z3::expr getValue(size_t input) const;
+
         /**
          * Returns the serial number.
          *
@@ -112,6 +335,199 @@ private:
         const size_t getNumber() const;
     }; // CounterExample
 
+    /**
+     * Counter example search running on its own thread and context, used by the pipelined CEGIS routine. The
+     * behavioral and negated correctness constraints are translated into the private context once. Each job fixes
+     * the implementation variables to the given valuation and collects up to a batch of distinct counter examples
+     * while the handler's thread continues with the implementation search.
+     */
+    class AsyncVerifier {
+
+    private:
+        /**
+         * The context exclusively used by the verification thread while a job is running.
+         */
+        z3::context context;
+        /**
+         * The solver holding the translated specification.
+         */
+        z3::solver solver;
+        /**
+         * Configuration the solver is built from.
+         */
+        const SolverConfiguration configuration;
+        /**
+         * The property translated into context.
+         */
+        z3::expr specification;
+        /**
+         * The implementation and input variables translated into context.
+         */
+        z3::expr_vector implementationVariables, inputVariables;
+        /**
+         * Counter examples found by the latest job, in context.
+         */
+        std::vector<z3::model> models;
+        /**
+         * Result of the running job. Invalid iff no job is running.
+         */
+        std::future<z3::check_result> job;
+        /**
+         * Runtime of the latest finished job in microseconds.
+         */
+        long runtime;
+
+    public:
+        /**
+         * Constructor. Translates the given variables and property into a private context.
+         *
+         * @param implVars The variables representing the sought implementation.
+         * @param inpVars The variables representing the possible inputs.
+         * @param property Constraints whose models are counter examples, i.e. behavioral and negated correctness
+         *                 constraints.
+         * @param config Configuration of the solver.
+         */
+        AsyncVerifier(const z3::expr_vector     & implVars,
+                      const z3::expr_vector     & inpVars,
+                      const z3::expr            & property,
+                      const SolverConfiguration & config);
+
+        /**
+         * Starts verifying the given implementation on the verification thread. No job may be running.
+         *
+         * @param valuation Numerals parallel to the implementation variables.
+         * @param batch Maximum number of distinct counter examples to collect.
+         * @param ms Timeout of each check in milliseconds.
+         */
+        void start(const std::vector<z3::expr> & valuation, size_t batch, unsigned ms);
+
+        /**
+         * Returns whether a job was started and not yet waited for.
+         *
+         * @return true iff a job is running.
+         */
+        bool isRunning() const;
+
+        /**
+         * Waits for the running job to finish and returns its counter examples.
+         *
+         * @param ctx Context into which the counter examples should be translated.
+         * @param found Receives the counter examples.
+         * @return sat iff counter examples were found, unsat iff the implementation is correct.
+         */
+        z3::check_result wait(z3::context & ctx, std::vector<z3::model> & found);
+
+        /**
+         * Returns the runtime of the latest finished job.
+         *
+         * @return Runtime in microseconds.
+         */
+        long getRuntime() const;
+
+        /**
+         * Interrupts the running job. Can be called from any thread.
+         */
+        void interrupt();
+
+        /**
+         * Clears a pending interrupt. No job may be running.
+         */
+        void clearInterrupts();
+    }; // AsyncVerifier
+
+    /**
+     * Class performing the relabeling of input and helper variables needed to instantiate the behavioral and
+     * correctness constraints for a counter example. The relabeled constants inp_i_k and hlp_i_k are created
+     * once per counter example k and interned, i.e. all later requests for the same counter example reuse them.
+     * The substitution skeleton, i.e. the conjunction of behavioral and correctness constraints together with
+     * the variables to replace, is built once so that each instantiation boils down to a single substitution.
+     */
+    class VariableRenamer {
+
+    private:
+        /**
+         * The context used for all relabeled constants.
+         */
+        z3::context * const context;
+        /**
+         * Input variables followed by helper variables, i.e. the variables to be relabeled.
+         */
+        z3::expr_vector variables;
+        /**
+         * The cached sorts of variables.
+         */
+        std::vector<z3::sort> sorts;
+        /**
+         * The name prefixes inp_i_ and hlp_i_ of variables.
+         */
+        std::vector<std::string> prefixes;
+        /**
+         * Number of input variables at the front of variables.
+         */
+        const size_t inputs;
+        /**
+         * The expression to be instantiated.
+         */
+        z3::expr skeleton;
+        /**
+         * The interned relabeled constants keyed by counter example number.
+         */
+        std::unordered_map<size_t, z3::expr_vector> symbols;
+
+    public:
+        /**
+         * Constructor. Prepares the relabeling of the given variables in the given expression.
+         *
+         * @param ctx The context used for all variables.
+         * @param inputVars The input variables to be relabeled as inp_i_k.
+         * @param helperVars The helper variables to be relabeled as hlp_i_k.
+         * @param expr The expression to be instantiated.
+         */
+        VariableRenamer(z3::context * const ctx,
+                        const z3::expr_vector & inputVars,
+                        const z3::expr_vector & helperVars,
+                        const z3::expr        & expr);
+
+        /**
+         * Returns the relabeled constants for the given counter example number. Input variables come first,
+         * helper variables afterwards. All of them are created at once on the first request.
+         *
+         * Numbers are positions in the current store, which setCorrectness() renumbers and an interrupted run may
+         * hand out again. The constants of a number are thus only meaningful while the instances built from them
+         * are: every renumbering goes along with setSkeleton() and a rebuild or backtrack of all solvers, and
+         * stored counter examples dropped on an interrupt were never instantiated.
+         *
+         * @param id The counter example number.
+         * @return The relabeled variables.
+         */
+        const z3::expr_vector & getSymbols(size_t id);
+
+        /**
+         * Returns the skeleton expression with all input and helper variables relabeled for the given counter
+         * example number.
+         *
+         * @param id The counter example number.
+         * @return The instantiated expression.
+         */
+        const z3::expr instantiate(size_t id);
+
+        /**
+         * Returns the number of variables relabeled per instance, i.e. the input and the remaining helper variables.
+         *
+         * @return The number of relabeled variables.
+         */
+        size_t getNumberOfVariables() const;
+
+        /**
+         * Replaces the expression to be instantiated, e.g. by a preprocessed one, and the helper variables to be
+         * relabeled. Previously relabeled constants are dropped.
+         *
+         * @param helperVars The helper variables occurring in expr.
+         * @param expr The new expression to be instantiated.
+         */
+        void setSkeleton(const z3::expr_vector & helperVars, const z3::expr & expr);
+    }; // VariableRenamer
+
     /**
      * Alias to use as findImplementation() return type.
      */
@@ -140,21 +556,14 @@ private:
     /**
      * Alias to use as findCounterExample() return type.
      */
-    using CounterExamplePair = std::pair<boost::optional<CounterExample>, z3::check_result>;
-    /**
-     * Returns the boost::optional<CounterExample> of a CounterExamplePair.
-     *
-     * @param ceP CounterExamplePair.
-     * @return First value of ceP, namely the optional CounterExample.
-     */
-    static inline const boost::optional<CounterExample> & getOCE(const CounterExamplePair & ceP) { return ceP.first; }
+    using CounterExamplePair = std::pair<std::vector<CounterExample>, z3::check_result>;
     /**
-     * Returns the CounterExample of a CounterExamplePair.
+     * Returns the CounterExamples of a CounterExamplePair.
      *
      * @param ceP CounterExamplePair.
-     * @return First value of ceP, namely the CounterExample.
+     * @return First value of ceP, namely the found CounterExamples. Empty iff none was found.
      */
-    static inline const CounterExample & getCE(const CounterExamplePair & ceP) { return ceP.first.get(); }
+    static inline const std::vector<CounterExample> & getCEs(const CounterExamplePair & ceP) { return ceP.first; }
     /**
      * Returns the result of a CounterExamplePair.
      *
@@ -163,6 +572,84 @@ private:
      */
     static inline const z3::check_result & getResult(const CounterExamplePair & ceP) { return ceP.second; }
 
+public:
+    /**
+     * A snapshot of the solver statistics relevant for benchmarking.
+     */
+    struct SolverStatistics {
+        /**
+         * Number of conflicts and decisions of the latest check.
+         */
+        unsigned long conflicts = 0, decisions = 0;
+        /**
+         * Memory in megabytes used by the solver's context.
+         */
+        double memory = 0.0;
+
+        /**
+         * Extracts the relevant values from the given Z3 statistics.
+         *
+         * @param st Statistics as returned by a solver.
+         * @return A snapshot of conflicts, decisions and memory.
+         */
+        static SolverStatistics from(const z3::stats & st);
+    };
+
+    /**
+     * Measurements of one iteration of the CEGIS routine, i.e. one implementation search followed by one
+     * counter example search. All times are given in microseconds.
+     */
+    struct IterationRecord {
+        /**
+         * Time spent in findImplementation() excluding the instantiation of counter examples.
+         */
+        long implementationTime = 0;
+        /**
+         * Time spent in findCounterExample().
+         */
+        long counterExampleTime = 0;
+        /**
+         * Time spent extracting the input constraints of counter examples.
+         */
+        long extractionTime = 0;
+        /**
+         * Time spent substituting variables to instantiate counter examples.
+         */
+        long substitutionTime = 0;
+        /**
+         * Number of counter examples found in this iteration.
+         */
+        size_t counterExamples = 0;
+        /**
+         * Size of the implementation solver's assertion set before its check.
+         */
+        size_t assertions = 0;
+        /**
+         * Number of counter example instances retired by pruning in this iteration.
+         */
+        size_t retired = 0;
+        /**
+         * Number of blocking clauses generalized from the refutations of this iteration.
+         */
+        size_t generalizations = 0;
+        /**
+         * Means by which the implementation of this iteration was verified.
+         */
+        Verifier verifier = Verifier::NONE;
+        /**
+         * Number of cubes checked by the counter example search in this iteration.
+         */
+        size_t cubes = 0;
+        /**
+         * Number of variables relabeled per counter example instance, i.e. inputs and helpers not preprocessed away.
+         */
+        size_t relabeled = 0;
+        /**
+         * Statistics of the implementation and the counter example search.
+         */
+        SolverStatistics implementationStatistics{}, counterExampleStatistics{};
+    };
+
     /**
     * The result type of the CEGIS routine storing the found implementation, all the counter examples
     * needed and the runtime.
@@ -183,9 +670,14 @@ private:
          */
         const z3::check_result result;
         /**
-         * Stores all the needed counter examples.
+         * Storage of the needed counter examples, shared with the handler. Only the first numberOfCounterExamples
+         * entries belong to this result.
+         */
+        const std::shared_ptr<const CounterExampleStore> counterExamples;
+        /**
+         * Number of counter examples found until the CEGIS routine stopped.
          */
-        const std::vector<CounterExample> counterExamples;
+        const size_t numberOfCounterExamples;
         /**
          * Start and end point of the CEGIS routine.
          */
@@ -194,6 +686,14 @@ private:
          * The name of the current implementation task.
          */
         const std::string name;
+        /**
+         * Per-iteration measurements. Empty iff statistics collection was disabled.
+         */
+        const std::vector<IterationRecord> iterations;
+        /**
+         * The reason why the CEGIS routine stopped.
+         */
+        const StopReason reason;
 
     public:
         /**
@@ -201,16 +701,33 @@ private:
          * representing the start and the end of the CEGIS routine.
          *
          * @param implTp The found valuation to the implementation variables plus the solver state.
-         * @param ces The needed counter examples during the CEGIS routine.
+         * @param ces Storage of the needed counter examples during the CEGIS routine.
+         * @param count Number of counter examples in ces belonging to this result.
          * @param start The time stamp where the CEGIS routine started.
          * @param end The time stamp where the CEGIS routine finished.
          * @param n The name of the current implementation task.
+         * @param its The per-iteration measurements.
+         * @param r The reason why the CEGIS routine stopped.
+         */
+        CEGISResult(const ImplementationPair           & implP,
+                    const std::shared_ptr<const CounterExampleStore> & ces,
+                    size_t                               count,
+                    const TimePoint                    & start,
+                    const TimePoint                    & end,
+                    const std::string                  & n,
+                    const std::vector<IterationRecord> & its,
+                    const StopReason                   & r);
+
+        /**
+         * Creates the result of a task that failed with an exception before or while running the CEGIS routine.
+         * It holds neither an implementation nor counter examples and its stop reason is ERROR.
+         *
+         * @param ctx Context of the task.
+         * @param start The time stamp where the task started.
+         * @param n The name of the task.
+         * @return The failed result.
          */
-        CEGISResult(const ImplementationPair          & implP,
-                    const std::vector<CounterExample> & ces,
-                    const TimePoint                   & start,
-                    const TimePoint                   & end,
-                    const std::string                 & n);
+        static CEGISResult failure(z3::context & ctx, const TimePoint & start, const std::string & n = "");
 
         /**
          * Indicates whether the CEGIS routine was able to find an implementation.
@@ -222,11 +739,23 @@ private:
         const z3::check_result check() const;
 
         /**
-         * Returns the valuation to the given variable. Returns the variable itself iff no valuation exists.
+         * Returns the valuation to the given variable. Returns the variable itself iff no valuation exists and
+         * completion is not requested.
          *
+         * @param completion Flag indicating whether the value verified for variables without valuation should be
+         *                   returned.
          * @return The valuation to the given (implementation) variables.
          */
-        const z3::expr getValuation(const z3::expr var) const;
+        const z3::expr getValuation(const z3::expr var, bool completion = false) const;
+
+        /**
+         * Returns the reason why the CEGIS routine stopped. Anything but SOLVED, UNREALIZABLE, UNKNOWN and ERROR
+         * indicates an early stop due to an exhausted budget; calling CEGISRoutine() again on the same handler
+         * resumes the search with all counter examples gathered so far.
+         *
+         * @return The reason why the CEGIS routine stopped.
+         */
+        StopReason getStopReason() const;
 
         /**
          * Gets the number of counter examples needed.
@@ -236,11 +765,20 @@ private:
         const size_t getNumberOfCounterExamples() const;
 
         /**
-         * Gets the runtime in milliseconds needed to execute the whole CEGIS routine.
+         * Returns the value of an input variable in one of the needed counter examples.
          *
-         * @return The runtime in milliseconds needed to execute the CEGIS routine.
+         * @param ce Index of the counter example, less than getNumberOfCounterExamples().
+         * @param input Position of the input variable.
+         * @return The value as a numeral.
          */
-        long getRuntime() const;
+        const z3::expr getCounterExampleValue(size_t ce, size_t input) const;
+
+        /**
+         * Gets the runtime in milliseconds needed to execute the whole CEGIS routine.
+         *
+         * @return The runtime in milliseconds needed to execute the CEGIS routine.
+         */
+        long getRuntime() const;
 
         /**
          * Writes formatted results to the given std::ostream object. std::cout is used if no std::ostream object
@@ -252,9 +790,31 @@ private:
          *            If csv is set, the header should look like this:
          *            Benchmark, Result, #Counter-examples, Runtime
          */
-        void print(std::ostream &out = std::cout, bool csv = false);
+        void print(std::ostream &out = std::cout, bool csv = false) const;
+
+        /**
+         * Returns the per-iteration measurements. Empty iff statistics collection was disabled.
+         *
+         * @return One record per iteration of the CEGIS routine.
+         */
+        const std::vector<IterationRecord> & getIterations() const;
+
+        /**
+         * Writes the per-iteration measurements to the given std::ostream object, either as comma-separated lines
+         * or as a JSON array of objects (one per iteration).
+         *
+         * @param out The std::ostream object to which the measurements should be written.
+         * @param json A flag to indicate whether the output should be formatted as JSON instead of CSV.
+         *             If csv is used, the header looks like this:
+         *             Benchmark, Iteration, Implementation, Counter-example, Extraction, Substitution,
+         *             #Counter-examples, #Assertions, Impl. conflicts, Impl. decisions, Impl. memory,
+         *             CE conflicts, CE decisions, CE memory, #Retired, #Generalizations,
+         *             Verifier, #Cubes, #Relabeled
+         */
+        void printIterations(std::ostream &out = std::cout, bool json = false) const;
     }; // CEGISResult
 
+private:
     /**
      * Alias for high_resolution_clock type of the std::chrono library.
      */
@@ -265,9 +825,12 @@ private:
      */
     const z3::expr_vector implementationVariables, inputVariables, helperVariables;
     /**
-     * The expression to solve splitted in different parts.
+     * The expression to solve splitted in different parts. The implementation and the correctness constraints can
+     * be edited via strengthenImplementation() and setCorrectness().
      */
-    const z3::expr implementationExpression, behavioralExpression, correctnessExpression;
+    z3::expr implementationExpression;
+    const z3::expr behavioralExpression;
+    z3::expr correctnessExpression;
     /**
      * The given context used for all variables.
      */
@@ -277,24 +840,405 @@ private:
      * variables and one to find counter examples for the found valuation.
      */
     z3::solver implementationSolver, counterExampleSolver;
+    /**
+     * Optional portfolio replacing the counterExampleSolver. Iff set, the counter example search is performed by
+     * several threads racing on their own contexts.
+     */
+    std::unique_ptr<SolverPortfolio> counterExamplePortfolio;
+    /**
+     * Optional pool of worker processes replacing the counterExampleSolver and the counterExamplePortfolio. Iff
+     * set, the counter example search is performed by separate processes racing on their own copies of the
+     * specification.
+     */
+    std::unique_ptr<ProcessPortfolio> counterExampleProcesses;
+    /**
+     * Optional portfolio replacing the implementationSolver. Iff set, all implementation constraints and
+     * counter example instances are added incrementally to every worker and the workers race on each
+     * implementation search.
+     */
+    std::unique_ptr<SolverPortfolio> implementationPortfolio;
+    /**
+     * The values of all counter examples created by this handler, shared with the results.
+     */
+    std::shared_ptr<CounterExampleStore> store;
     /**
      * A vector storing all found counter examples.
      */
     std::vector<CounterExample> counterExamples;
+    /**
+     * Number of counter examples (from the front of counterExamples) already added to the implementationSolver.
+     */
+    size_t instantiatedCounterExamples = 0;
+    /**
+     * Maximum number of distinct counter examples collected for one implementation.
+     */
+    size_t batchSize = 1;
+    /**
+     * Flag indicating whether per-iteration measurements should be collected.
+     */
+    bool collectStatistics = false;
+    /**
+     * Per-iteration measurements of the current run.
+     */
+    std::vector<IterationRecord> iterations;
+    /**
+     * Flag indicating whether the solvers already hold the implementation and specification constraints.
+     */
+    bool initialized = false;
+
+    /**
+     * Wall-clock budget in milliseconds per call of CEGISRoutine(). 0 means unlimited.
+     */
+    unsigned timeout = 0;
+    /**
+     * Flag indicating whether a solver timeout was applied and has to be lifted again.
+     */
+    bool timeoutApplied = false;
+    /**
+     * Maximum number of counter examples. 0 means unlimited.
+     */
+    size_t maxCounterExamples = 0;
+    /**
+     * Ceiling for Z3's memory consumption in megabytes. 0 means unlimited.
+     */
+    size_t memoryLimit = 0;
+    /**
+     * Deadline of the current run derived from timeout.
+     */
+    clock::time_point deadline;
+    /**
+     * Flag set by cancel() to stop the current (or next) run.
+     */
+    std::atomic<bool> cancelled{false};
+    /**
+     * Flag set whenever the solvers were interrupted or gave up. Popping a backtracking point of an interrupted
+     * solver may leave stale assertions behind, hence no verdict is accepted afterwards and the next run starts
+     * from rebuilt solvers. Also set by setSolverConfiguration() on a live handler to get the same rebuild.
+     */
+    std::atomic<bool> solversInterrupted{false};
+    /**
+     * Flag indicating whether a run is in progress, i.e. whether cancel() has to interrupt the solvers. Setting up
+     * and cleaning up the solvers must not be interrupted. Guarded by runMutex.
+     */
+    bool running = false;
+    std::mutex runMutex;
+
+    /**
+     * Executes the CEGIS loop until a result was found or the budget is exhausted.
+     *
+     * @param start The time stamp where the CEGIS routine started.
+     * @return The result of the CEGIS routine.
+     */
+    const CEGISResult runLoop(const clock::time_point & start);
+
+    /**
+     * Checks whether the deadline passed, the memory ceiling was exceeded or the routine was cancelled. Does not
+     * access any state modified by the CEGIS loop and can therefore be called from the watchdog thread.
+     *
+     * @param reason Set to the reason of the stop iff the budget is exhausted.
+     * @return true iff the routine has to stop.
+     */
+    bool budgetExhausted(StopReason & reason) const;
+
+    /**
+     * Sets the solver timeouts of both the implementation and the counter example search to the time left until
+     * the deadline.
+     */
+    void applyTimeout();
+
+    /**
+     * Interrupts all solvers of the handler, i.e. the handler's context and all portfolio workers.
+     */
+    void interruptSolvers();
+
+    /**
+     * Computes a hash over the variables (names and sorts) and all three expressions of the specification.
+     *
+     * @return The hash as a string of 16 hexadecimal digits.
+     */
+    const std::string specificationHash() const;
+
+    /**
+     * Positions of the inputs of every symmetry group.
+     */
+    std::vector<std::vector<size_t>> symmetryGroups;
+    /**
+     * Maximum number of further counter examples instantiated per orbit.
+     */
+    size_t orbitLimit = 64;
+    /**
+     * Keys of the valuations of all counter examples recorded so far. Only maintained if symmetry groups are set.
+     */
+    std::unordered_set<std::string> counterExampleIndex;
+    /**
+     * Keys of the canonical forms of all counter examples whose orbits were instantiated.
+     */
+    std::unordered_set<std::string> orbitIndex;
+
+    /**
+     * Drops the stored counter examples that were not recorded yet, e.g. a batch whose processing was interrupted,
+     * so that the position of every counter example in the store equals its position in counterExamples again.
+     */
+    void discardPendingCounterExamples();
+
+    /**
+     * Appends the given counter examples to counterExamples. If symmetry groups are set, the orbit of each one
+     * not known yet is appended as well, i.e. all distinct valuations obtained by permuting the values within the
+     * groups, up to orbitLimit of them.
+     *
+     * @param ces The counter examples, the latest entries of the store in this order.
+     */
+    void recordCounterExamples(const std::vector<CounterExample> & ces);
+
+    /**
+     * Number of refuted implementations after which the counter examples are pruned. 0 disables pruning.
+     */
+    size_t pruneInterval = 0;
+    /**
+     * Number of retired counter example instances residing in the implementationSolver that triggers a rebuild.
+     */
+    size_t rebuildThreshold = 0;
+    /**
+     * Tracking literals of the counter example instances in the implementationSolver, parallel to counterExamples.
+     * Only used if pruning is enabled.
+     */
+    std::vector<z3::expr> trackingLiterals;
+    /**
+     * Flags indicating which counter examples are still active, parallel to counterExamples.
+     */
+    std::vector<bool> activeCounterExamples;
+    /**
+     * Number of retired counter example instances still residing in the implementationSolver.
+     */
+    size_t retiredInstances = 0;
+    /**
+     * Constraints of all implementations refuted so far. Only recorded if pruning is enabled.
+     */
+    std::vector<z3::expr> refutedImplementations;
+    /**
+     * Number of refuted implementations at the time of the latest pruning step.
+     */
+    size_t prunedAt = 0;
+    /**
+     * AST ids of the tracking literals appearing in the unsat core of any refuted implementation.
+     */
+    std::unordered_set<unsigned> usefulLiterals;
+
+    /**
+     * Returns the tracking literals of all active counter examples.
+     *
+     * @return The assumptions for the implementationSolver.
+     */
+    z3::expr_vector activeAssumptions() const;
+
+    /**
+     * Retires all counter examples that are not needed to rule out any implementation refuted so far. For each
+     * implementation refuted since the latest pruning step, the unsat core of the implementationSolver under the
+     * active tracking literals names the counter examples blocking it; all counter examples appearing in no core
+     * so far are deactivated. Rebuilds the implementationSolver from the active counter examples once
+     * rebuildThreshold is reached.
+     */
+    void pruneCounterExamples();
+
+    /**
+     * Replaces the implementationSolver by a new one holding only the implementation constraints, the
+     * generalizations, the blocked implementations, the cost bounds and the instances of all active counter
+     * examples, within one backtracking point as set up by initializeSolvers().
+     */
+    void rebuildImplementationSolver();
+
+    /**
+     * Flag indicating whether the instantiated constraints are preprocessed once before the first instantiation.
+     */
+    bool preprocessing = false;
+
+    /**
+     * Simplifies the conjunction of behavioral and correctness constraints that is instantiated for every counter
+     * example. Helper variables defined by top-level equations h == f(...) with h not occurring in f are
+     * substituted by their definitions, afterwards the remainder is simplified by equivalence preserving tactics.
+     * The result replaces the skeleton of the renamer.
+     */
+    void preprocess();
+
+    /**
+     * Replaces the generalizationSolver by a new one without any assertions, configured to find small cores iff
+     * refuted implementations are generalized.
+     */
+    void initializeGeneralizationSolver();
+
+    /**
+     * Sets up the solvers of both searches and the generalizationSolver from the recorded state, i.e. the
+     * implementation constraints, the generalizations, the blocked implementations, the cost bounds and the
+     * specification. All of it is asserted within one backtracking point above an empty base level. Solvers used
+     * before are backtracked to that level, or replaced by fresh ones iff they were interrupted. The counter
+     * examples are instantiated again by the next findImplementation().
+     */
+    void initializeSolvers();
+
+    /**
+     * Sets up the simulator iff simulation or truth table verification is enabled and the specification can be
+     * simulated.
+     */
+    void initializeSimulator();
+
+    /**
+     * Flag indicating whether refuted implementations are generalized via unsat cores.
+     */
+    bool coreGeneralization = false;
+    /**
+     * Solver holding the behavioral and correctness constraints. Used to determine which parts of a refuted
+     * implementation are responsible for its failure on a counter example, and to check speculative
+     * implementations of the pipeline against new counter examples.
+     */
+    z3::solver generalizationSolver;
+    /**
+     * Blocking clauses derived by generalizeRefutation(). Kept to survive rebuilds of the implementationSolver.
+     */
+    std::vector<z3::expr> generalizations;
+    /**
+     * Blocking clauses of the implementations reported by enumerateImplementations(). Kept to survive rebuilds of
+     * the implementationSolver.
+     */
+    std::vector<z3::expr> blockedImplementations;
+    /**
+     * Cost bounds added by minimize(), either permanent or guarded by a tracking literal. Kept to survive rebuilds
+     * of the implementationSolver.
+     */
+    std::vector<z3::expr> costBounds;
+    /**
+     * Tracking literal of the tentative cost bound that is assumed by the current implementation search.
+     */
+    boost::optional<z3::expr> costAssumption;
+
+    /**
+     * Generalizes the refutation of the given implementation by the given counter examples. For each counter
+     * example, the generalizationSolver checks the behavioral and correctness constraints with the counter
+     * example's inputs fixed and the implementation's valuation given bit by bit as tracked assumptions. The unsat
+     * core names the bits the failure depends on; a clause blocking exactly these bits is added to the
+     * implementation search, ruling out all implementations that agree with the refuted one on them.
+     *
+     * @param impl The refuted implementation.
+     * @param ces Counter examples refuting impl.
+     */
+    void generalizeRefutation(const Implementation & impl, const std::vector<CounterExample> & ces);
+
+    /**
+     * Number of inputs simulated at once before each counter example search. 0 disables simulation.
+     */
+    size_t simulationLanes = 0;
+    /**
+     * Number of random batches simulated per implementation.
+     */
+    size_t simulationRounds = 1;
+    /**
+     * Maximum number of Boolean inputs for which implementations are verified by enumerating the truth table.
+     * 0 disables truth table verification.
+     */
+    size_t truthTableThreshold = 16;
+    /**
+     * Flag indicating whether the simulator verifies implementations exhaustively.
+     */
+    bool truthTables = false;
+    /**
+     * The compiled specification. Only set iff simulation or truth table verification is used and the
+     * specification is supported.
+     */
+    std::unique_ptr<Simulator> simulator;
+
+    /**
+     * Flag indicating whether the counter example search is overlapped with the implementation search.
+     */
+    bool pipelining = false;
+    /**
+     * Verifier of the pipelined CEGIS routine. Created on its first use.
+     */
+    std::unique_ptr<AsyncVerifier> asyncVerifier;
+    /**
+     * Tracking literal of the clause excluding the implementation under verification, assumed by speculative
+     * implementation searches. Set iff such a search is running.
+     */
+    boost::optional<z3::expr> speculationAssumption;
+    /**
+     * Number of speculative implementations, i.e. of created tracking literals.
+     */
+    size_t speculations = 0;
+
+    /**
+     * Configurations of the implementationSolver and the counterExampleSolver (also used by the verification thread
+     * of the pipelined routine).
+     */
+    SolverProfile profile;
+
+    /**
+     * Number of split literals the counter example search is sharded on, i.e. the current cube depth. 0 iff cube
+     * sharding is disabled.
+     */
+    unsigned cubeDepth = 0;
+    /**
+     * Lower bound of the adaptive cube depth. Ensures at least one cube per worker.
+     */
+    unsigned minCubeDepth = 0;
+    /**
+     * Literals fixing single top bits of the inputs, the widest inputs first. The first cubeDepth ones are split on.
+     */
+    std::vector<z3::expr> splitLiterals;
+
+    /**
+     * Builds the split literals for cube sharding by taking the most significant bits of the inputs round-robin,
+     * starting with the widest one.
+     */
+    void initializeSplits();
+
+    /**
+     * Executes the pipelined CEGIS loop. While an implementation is verified on the verification thread, the
+     * implementation search already looks for the next one that differs from it. Counter examples are merged as
+     * soon as both phases are done; the speculative implementation is discarded iff it does not survive them.
+     *
+     * @param start The time stamp where the CEGIS routine started.
+     * @return The result of the CEGIS routine.
+     */
+    const CEGISResult runPipeline(const clock::time_point & start);
+
+    /**
+     * Checks whether the given implementation works correctly on all of the given counter examples, i.e. whether
+     * it is not refuted by them.
+     *
+     * @param impl Implementation to be checked.
+     * @param ces Counter examples to check impl on.
+     * @return sat iff impl is still a candidate, unsat iff one of ces refutes it.
+     */
+    z3::check_result isConsistent(const Implementation & impl, const std::vector<CounterExample> & ces);
 
     /**
-     * Counts the number of created counter examples.
+     * Returns the time left until the deadline.
+     *
+     * @return Milliseconds left, or the maximum value iff no timeout is set.
+     */
+    unsigned remainingTime() const;
+
+    /**
+     * Simulates the given implementation, either on all inputs iff truth tables are used or on random inputs
+     * otherwise. All failing inputs are counter examples and make the counter example search unnecessary.
+     *
+     * @param impl Implementation to be simulated.
+     * @param ces Receives up to batchSize counter examples.
+     * @return z3::sat iff counter examples were found, z3::unsat iff the truth table showed the implementation to
+     *         be correct, and z3::unknown iff the counter example search is still needed.
      */
-    static size_t ceID;
+    z3::check_result simulate(const Implementation & impl, std::vector<CounterExample> & ces);
 
     /**
-     * Template used for substituting the input variables during the CEGIS routine.
+     * Returns the microseconds passed since the given time point.
+     *
+     * @param since Time point to measure from.
+     * @return Elapsed time in microseconds.
      */
-    const boost::format INPUT_VAR_TEMPLATE{"inp_%1%_%2%"};
+    static long elapsed(const clock::time_point & since);
+
     /**
-     * Template used for substituting the helper variables during the CEGIS routine.
+     * Relabels input and helper variables when instantiating counter examples.
      */
-    const boost::format HELPER_VAR_TEMPLATE{"hlp_%1%_%2%"};
+    VariableRenamer renamer;
 
     /**
      * Name of the current implementation task.
@@ -310,32 +1254,84 @@ private:
     const ImplementationPair findImplementation();
 
     /**
-     * Given the current Implementation, this function calls the counterExampleSolver to find a new valuation
-     * to the input variables that leads to a contradiction.
+     * Given the current Implementation, this function calls the counterExampleSolver to find new valuations
+     * to the input variables that lead to a contradiction. Up to batchSize distinct valuations are collected by
+     * blocking each found one and asking again.
      *
-     * @param impl Current implementation for which a counter example should be found.
-     * @return A boost::optional containing this contradiction, i.e. the valuation of the input variables, as
-     * a CounterExample object iff one was found.
+     * @param impl Current implementation for which counter examples should be found.
+     * @return A vector containing these contradictions, i.e. the valuations of the input variables, as
+     * CounterExample objects together with the result of the first check.
      */
     const CounterExamplePair findCounterExample(const Implementation & impl);
 
     /**
-     * Returns a z3::expr where all variables of vars appearing in expr are replaced by the pattern templ using the
-     * current number of counter examples.
+     * Adds the given constraint to the implementation search.
+     *
+     * @param e Constraint to be added.
+     */
+    void implementationAdd(const z3::expr & e);
+    /**
+     * Checks the assertions of the implementation search.
+     *
+     * @return The result returned by Z3.
+     */
+    z3::check_result implementationCheck();
+    /**
+     * Returns the model of the latest successful implementationCheck() in the handler's context.
+     *
+     * @return The model found by the implementation search.
+     */
+    z3::model implementationModel();
+
+    /**
+     * Drops all assertions of the implementation search by replacing its solvers with fresh ones.
+     */
+    void implementationReset();
+
+    /**
+     * Creates a backtracking point in the implementation search.
+     */
+    void implementationPush();
+    /**
+     * Backtracks one level in the implementation search.
+     */
+    void implementationPop();
+    /**
+     * Drops all assertions of the counter example search by replacing its solvers with fresh ones.
+     */
+    void verifierReset();
+    /**
+     * Creates a backtracking point in the counter example search.
+     */
+    void verifierPush();
+    /**
+     * Adds the given constraint to the counter example search.
+     *
+     * @param e Constraint to be added.
+     */
+    void verifierAdd(const z3::expr & e);
+    /**
+     * Checks the assertions of the counter example search.
      *
-     * @param expr Expression to be substituted.
-     * @param vars Variables to be substituted in expr.
-     * @param templ Pattern to perform the substitution.
-     * @return A substituted expression.
+     * @return The result returned by Z3.
+     */
+    z3::check_result verifierCheck();
+    /**
+     * Returns the model of the latest successful verifierCheck() in the handler's context.
+     *
+     * @return The model found by the counter example search, boost::none iff a worker process died before
+     *         handing it out.
+     */
+    boost::optional<z3::model> verifierModel();
+    /**
+     * Backtracks one level in the counter example search.
      */
-    const z3::expr substituteVars(const z3::expr        & expr,
-                                  const z3::expr_vector & vars,
-                                        boost::format     templ) const;
+    void verifierPop();
 
 public:
     /**
      * Constructor. Creates a CEGISHandler object that is able to perform the CEGIS routine.
-     * Requires a lot of parameters to keep the class immutable.
+     * The specification can be edited afterwards via strengthenImplementation() and setCorrectness().
      *
      * @param ctx Pointer to the used context for all variables.
      * @param implVars The variables representing the sought implementation.
@@ -362,6 +1358,67 @@ public:
      */
     const CEGISResult CEGISRoutine();
 
+    /**
+     * Enumerates distinct correct implementations. Runs the CEGIS routine until a correct implementation is found,
+     * passes it to the given callback, blocks it and continues the search. Solvers and counter examples are kept
+     * alive in between, so every further implementation benefits from all counter examples gathered so far.
+     * Budgets set by setTimeout() and setMaxCounterExamples() apply to the search for each single implementation.
+     *
+     * @param callback Receives each found implementation as soon as it was verified. Returning false stops the
+     *                 enumeration.
+     * @param k Maximum number of implementations to enumerate. 0 enumerates all of them.
+     * @return The number of implementations passed to the callback.
+     */
+    size_t enumerateImplementations(const std::function<bool(const CEGISResult &)> & callback, size_t k = 0);
+
+    /**
+     * Searches for a correct implementation of minimal cost. After a first correct implementation was found, the
+     * cost bound is tightened step by step according to the given strategy and the CEGIS routine is continued
+     * under each bound. Solvers and counter examples are kept alive across all bounds. Infeasible bounds are
+     * turned into lower bounds and tentative ones (binary search) are assumed via tracking literals, so that no
+     * counter example is lost. Binary search falls back to linear search iff an implementation portfolio is used.
+     * Budgets set by setTimeout() and setMaxCounterExamples() apply to the search under each single bound.
+     *
+     * @param cost Term over the implementation variables of integer or (unsigned) bit-vector sort whose values fit
+     *             into 63 bits.
+     * @param callback Receives each improving implementation as soon as it was verified. Its cost can be obtained
+     *                 via getValuation(cost, true). Returning false stops the search.
+     * @param search Strategy to tighten the cost bound.
+     * @return StopReason::SOLVED iff the last reported implementation is proven to be optimal,
+     *         StopReason::UNREALIZABLE iff no correct implementation exists, StopReason::CANCELLED iff the
+     *         callback stopped the search, and the reason of the early stop otherwise.
+     */
+    StopReason minimize(const z3::expr & cost, const std::function<bool(const CEGISResult &)> & callback,
+                        CostSearch search = CostSearch::LINEAR);
+
+    /**
+     * Adds the given constraint to the implementation constraints of a live handler, e.g. a tighter sketch. All
+     * counter examples, generalizations and bounds stay valid as the set of candidate implementations only
+     * shrinks, hence the constraint is simply added to the implementation search and the next call of
+     * CEGISRoutine() continues with the complete solver state. Must not be called from within the callbacks of
+     * enumerateImplementations() and minimize().
+     *
+     * @param constraint Constraint over the implementation variables.
+     */
+    void strengthenImplementation(const z3::expr & constraint);
+
+    /**
+     * Replaces the correctness constraints of a live handler, e.g. by adding a property. Counter examples are
+     * re-validated by substituting their inputs into the new correctness constraints: those for which they
+     * simplify to true, e.g. inputs outside the premise of an added property, are dropped, all others are kept.
+     * Dropping is sound as counter examples only narrow the implementation search. The specification dependent
+     * state, i.e. the counter example instances, generalizations, cost bounds and refuted implementations of the
+     * pruning, is discarded by backtracking both searches to their empty base level. The implementation search
+     * continues from the implementation constraints and the blocked implementations, the counter example search
+     * from the new constraints, and the kept counter examples are instantiated again by the next call of
+     * CEGISRoutine(). The solvers, portfolios and worker processes are kept alive. Must not be called from within
+     * the callbacks of enumerateImplementations() and minimize().
+     *
+     * @param corrExpr The new correctness constraints.
+     * @return The number of kept counter examples.
+     */
+    size_t setCorrectness(const z3::expr & corrExpr);
+
     /**
      * Sets the name of the current implementation task.
      *
@@ -369,6 +1426,242 @@ public:
      */
     void setName(std::string n);
 
+    /**
+     * Rebuilds the solver of the given role according to the given configuration, e.g. a bit-blasting tactic
+     * pipeline with tuned SAT parameters for QF_BV specifications. Applies to the implementationSolver and the
+     * counterExampleSolver (and to the verification thread of the pipelined routine), but not to portfolios and
+     * worker processes. If called after CEGISRoutine(), the next run rebuilds all solvers from scratch and
+     * instantiates the kept counter examples again.
+     *
+     * @param role The solver to be configured.
+     * @param config Its tactic pipeline and parameters.
+     */
+    void setSolverConfiguration(SolverRole role, const SolverConfiguration & config);
+
+    /**
+     * Configures both solvers according to the given profile, e.g. one written by the Autotuner. Has to be called
+     * before CEGISRoutine().
+     *
+     * @param p The profile.
+     */
+    void setSolverProfile(const SolverProfile & p);
+
+    /**
+     * Enables the parallel counter example search. Each of the given number of workers gets a copy of the
+     * behavioral and the negated correctness constraints in its own context. The workers race on each
+     * implementation and the first one finding an answer wins. Worker i uses the tactic pipeline
+     * tactics[i % tactics.size()] (tactic names separated by ';') and random seed i. Has to be called before
+     * CEGISRoutine().
+     *
+     * @param workers Number of threads to use for the counter example search. Values < 2 disable the portfolio.
+     * @param tactics Tactic pipelines to distribute among the workers. Default solvers are used iff empty.
+     */
+    void setCounterExamplePortfolio(size_t workers, const std::vector<std::string> & tactics = {});
+
+    /**
+     * Moves the counter example search into the given number of worker processes, each with its own address space
+     * and Z3 heap, so that a crash or memory blow-up of a solver does not take down the handler. The behavioral and
+     * the negated correctness constraints are shipped once as SMT-LIB2, afterwards only candidate implementations
+     * and counter examples are exchanged. The workers race on each implementation with random seeds 0, 1, ... and
+     * are restarted transparently if they die or exceed their memory limit. Takes precedence over
+     * setCounterExamplePortfolio(). Has to be called before CEGISRoutine().
+     *
+     * @param workers Number of worker processes. 0 disables the process portfolio.
+     * @param executable Path to the cegis_worker executable. Looked up in PATH if it contains no slash.
+     * @param megabytes Memory limit per worker in megabytes. 0 for no limit.
+     */
+    void setVerificationProcesses(size_t workers, const std::string & executable = "cegis_worker",
+                                  size_t megabytes = 0);
+
+    /**
+     * Enables the pipelined CEGIS routine. The verification of an implementation runs on its own thread and
+     * context while the implementation search already looks for a speculative next implementation, differing from
+     * the one under verification. Counter examples are merged as soon as both phases are done and the speculative
+     * implementation is discarded iff they refute it. Hides the latency of the shorter phase on two or more cores.
+     * Simulation still falsifies candidates before they are handed to the verification thread, but the
+     * counter example portfolios and processes are not used. Requires the plain implementationSolver, i.e. is
+     * ignored if an implementation portfolio is set. Has to be called before CEGISRoutine().
+     *
+     * @param enable true to overlap implementation search and verification.
+     */
+    void setPipelining(bool enable);
+
+    /**
+     * Enables cube-and-conquer sharding of the counter example search. The input space is split into 2^depth cubes
+     * by fixing the most significant bits of the widest inputs, and the cubes are solved in parallel by the workers
+     * of the counter example portfolio (one per hardware thread iff setCounterExamplePortfolio() was not called).
+     * The first cube containing a counter example stops all others, an implementation is correct iff all cubes are
+     * unsatisfiable. The depth adapts to the runtime of the cubes: it grows while single cubes take long and
+     * shrinks while they are trivial. Ignored iff worker processes are used. Has to be called before CEGISRoutine().
+     *
+     * @param depth Initial number of split bits. 0 disables cube sharding.
+     */
+    void setCubeSharding(unsigned depth);
+
+    /**
+     * Enables the parallel implementation search. Each of the given number of workers keeps its own copy of the
+     * implementation constraints in its own context and receives every new counter example instance
+     * incrementally. The workers race on each implementation search and the first one finding an answer wins.
+     * Worker i uses the tactic pipeline tactics[i % tactics.size()] (tactic names separated by ';', an empty
+     * string denotes the default solver) and random seed i, e.g. {"", "simplify;bit-blast;sat"} races the SMT
+     * core against a bit-blasting SAT solver. Has to be called before CEGISRoutine().
+     *
+     * @param workers Number of threads to use for the implementation search. Values < 2 disable the portfolio.
+     * @param tactics Tactic pipelines to distribute among the workers. Default solvers are used iff empty.
+     */
+    void setImplementationPortfolio(size_t workers, const std::vector<std::string> & tactics = {});
+
+    /**
+     * Sets the maximum number of distinct counter examples collected per iteration. After the first counter
+     * example has been found, its input valuation is blocked and the search continues within the same scope until
+     * k counter examples were found or no more exist. All of them are added to the implementationSolver at once.
+     *
+     * @param k Maximum number of counter examples per iteration. Values < 1 are treated as 1.
+     */
+    void setBatchSize(size_t k);
+
+    /**
+     * Enables or disables the collection of per-iteration measurements, i.e. the time spent in the single phases
+     * of the CEGIS routine, the size of the implementation solver's assertion set and statistics of both solvers.
+     * They can be accessed via the CEGISResult. Disabled by default.
+     *
+     * @param enable Flag indicating whether measurements should be collected.
+     */
+    void setStatistics(bool enable);
+
+    /**
+     * Sets a wall-clock budget for each call of CEGISRoutine(). It is enforced via Z3 solver timeouts and by
+     * interrupting running checks once the deadline passed.
+     *
+     * @param ms Budget in milliseconds. 0 means unlimited (default).
+     */
+    void setTimeout(unsigned ms);
+
+    /**
+     * Sets the maximum number of counter examples. The routine stops as soon as at least this many were found.
+     *
+     * @param n Maximum number of counter examples. 0 means unlimited (default).
+     */
+    void setMaxCounterExamples(size_t n);
+
+    /**
+     * Sets a ceiling for Z3's memory consumption. Running checks are interrupted once it is exceeded. Note that
+     * Z3 only provides a process-wide estimate, so all contexts of the process are accounted.
+     *
+     * @param megabytes The ceiling in megabytes. 0 means unlimited (default).
+     */
+    void setMemoryLimit(size_t megabytes);
+
+    /**
+     * Stops the running CEGIS routine as soon as possible. If no routine is running, the next one stops
+     * immediately. Safe to be called from any thread. Only the loop of the routine is interrupted, never the set up
+     * or the clean up of its solvers.
+     */
+    void cancel();
+
+    /**
+     * Writes all counter examples gathered so far to the given file. Each counter example is stored as one line of
+     * input values; the header holds the names and sorts of the input variables and a hash of the specification.
+     *
+     * @param file Path of the file to be written.
+     * @return true iff the file was written successfully.
+     */
+    bool saveCounterExamples(const std::string & file) const;
+
+    /**
+     * Loads counter examples written by saveCounterExamples(). The file is streamed line by line, each counter
+     * example is added to the handler and will be taken into account by the first implementation search, i.e. a
+     * new handler starts with all known constraints. Since counter examples are input valuations, they remain
+     * valid for related specifications over the same input variables, which are matched by name and sort. Lines
+     * without a value for every stored input, with an undecodable value or without their newline, e.g. the last
+     * one of a file truncated by an interrupted run, are skipped.
+     *
+     * @param file Path of the file to be read.
+     * @param sameSpecification Only load the counter examples iff they stem from an identical specification.
+     * @param skipped Receives the number of skipped lines iff not null.
+     * @return The number of loaded counter examples. 0 if the file could not be read, an input variable is
+     *         missing or the specification differs although sameSpecification was set.
+     */
+    size_t loadCounterExamples(const std::string & file, bool sameSpecification = false, size_t * skipped = nullptr);
+
+    /**
+     * Enables counter example pruning to keep the implementation formula small. Every counter example instance is
+     * added under a tracking literal. Each time the given number of implementations has been refuted, the unsat
+     * cores of the newly refuted implementations are computed and counter examples that never appeared in any
+     * core are retired, i.e. no longer assumed. Once the given number of retired instances accumulated in the
+     * implementationSolver, it is rebuilt from the useful counter examples only. All refuted implementations stay
+     * ruled out, so the search cannot cycle. Only applies to the implementationSolver, i.e. has no effect if an
+     * implementation portfolio is used. Has to be called before CEGISRoutine().
+     *
+     * @param interval Number of refuted implementations between two pruning steps. 0 disables pruning (default).
+     * @param threshold Number of retired instances triggering a rebuild of the implementationSolver.
+     */
+    void setPruning(size_t interval, size_t threshold = 64);
+
+    /**
+     * Declares groups of interchangeable inputs, e.g. the operands of a commutative operation or identical bus
+     * lines. Every counter example found is then instantiated together with its orbit, i.e. all distinct
+     * valuations obtained by permuting the values within each group, as they are likely to refute the next
+     * implementations as well. The canonical form of each counter example (the values sorted within each group)
+     * is looked up in a hashed index, so every orbit is instantiated only once and no valuation twice. Orbit
+     * members are sound constraints for any specification; the fewer implementations treat the grouped inputs
+     * alike, the more iterations they save. They count as counter examples of the result. Throws a z3::exception
+     * iff a group contains a variable that is no input, inputs of different sorts or sorts other than Boolean and
+     * bit-vector, or if groups overlap. Has to be called before CEGISRoutine() and loadCounterExamples().
+     *
+     * @param groups The groups of input variables. An empty vector disables symmetry handling.
+     * @param orbitLimit Maximum number of further counter examples instantiated per counter example.
+     */
+    void setSymmetryGroups(const std::vector<z3::expr_vector> & groups, size_t orbitLimit = 64);
+
+    /**
+     * Enables or disables the generalization of refuted implementations. Besides the counter example itself, each
+     * refutation then yields a clause over only those implementation bits the failure actually depends on, as
+     * determined by an unsat core. A single verification call can thereby rule out a large family of
+     * implementations, which pays off for sketches with many don't-care implementation bits. Disabled by default.
+     * Has to be called before CEGISRoutine().
+     *
+     * @param enable Flag indicating whether refuted implementations should be generalized.
+     */
+    void setCoreGeneralization(bool enable);
+
+    /**
+     * Enables the preprocessing of the constraints instantiated for every counter example. Helper variables that
+     * are functionally defined by top-level equations h == f(...) of the behavioral or correctness constraints are
+     * substituted away, and the remaining constraints are simplified by the tactics simplify, propagate-values and
+     * ctx-simplify. Done once before the first instantiation, so every counter example adds a smaller instance
+     * with fewer fresh constants to the implementationSolver. The counter example search still works on the
+     * original constraints. Disabled by default. Has to be called before CEGISRoutine().
+     *
+     * @param enable Flag indicating whether the instantiated constraints should be preprocessed.
+     */
+    void setPreprocessing(bool enable);
+
+    /**
+     * Enables the falsification of implementations by simulation. Before the counter example search, each
+     * implementation is evaluated on the given number of random inputs at once by a compiled evaluator of the
+     * specification. Failing inputs become counter examples and the solver call is skipped; the solver is only
+     * consulted iff simulation finds nothing. Requires the specification to lie within the Boolean and bit-vector
+     * fragment (up to 64 bits per term) and helper variables to be defined by top-level equations h == f(...) of
+     * the behavioral constraints. Otherwise, simulation is silently disabled. Has to be called before
+     * CEGISRoutine().
+     *
+     * @param lanes Number of inputs simulated at once, e.g. 64, 256 or 512. 0 disables simulation (default).
+     * @param rounds Number of random batches simulated per implementation.
+     */
+    void setSimulation(size_t lanes, size_t rounds = 1);
+
+    /**
+     * Sets the maximum number of inputs for truth table verification. If all input variables are Boolean (or
+     * single bit vectors), there are at most n of them and the specification can be simulated (see
+     * setSimulation()), implementations are verified by evaluating all 2^n inputs on packed truth tables with the
+     * helper variables evaluated from their definitions instead of calling the counter example solver. Up to
+     * batchSize failing minterms are returned as counter examples. Has to be called before CEGISRoutine().
+     *
+     * @param n Maximum number of inputs. 0 disables truth table verification. Defaults to 16.
+     */
+    void setTruthTableThreshold(size_t n);
+
 };
 
 #endif //CEGIS_CEGIS_H
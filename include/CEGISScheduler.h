@@ -0,0 +1,142 @@
+//
+// Created by marcel on 16.10.26.
+//
+
+#ifndef CEGIS_CEGISSCHEDULER_H
+#define CEGIS_CEGISSCHEDULER_H
+
+#include <deque>
+#include <functional>
+#include <thread>
+#include <condition_variable>
+#include "CEGIS.h"
+
+/**
+ * Scheduler running many independent synthesis tasks on a work-stealing thread pool. Every worker owns its own
+ * z3::context which is handed to the tasks it executes, so handlers never share a context across threads.
+ * Results are streamed to a callback as soon as the respective task completes.
+ */
+class CEGISScheduler {
+
+public:
+    /**
+     * Description of a synthesis task. Gets the worker's context and has to create all variables, constraints and
+     * the handler within it. The handler may be configured freely, e.g. with a name or a timeout. A task that
+     * throws, or whose CEGIS routine throws, is reported as a result with StopReason::ERROR.
+     */
+    using Task = std::function<std::unique_ptr<CEGISHandler>(z3::context &)>;
+    /**
+     * Receives the result of every completed task. Invoked on the worker thread that executed the task while
+     * holding a lock, i.e. never concurrently. The result refers to the worker's context and is only valid for
+     * the duration of the call.
+     */
+    using ResultCallback = std::function<void(const CEGISHandler::CEGISResult &)>;
+
+private:
+    /**
+     * A member of the pool owning its context and its queue of tasks.
+     */
+    struct Worker {
+        /**
+         * The context used by all tasks executed on this worker.
+         */
+        z3::context context;
+        /**
+         * Pending tasks. The owner takes from the front, thieves take from the back.
+         */
+        std::deque<Task> tasks;
+        /**
+         * Guards tasks.
+         */
+        std::mutex mutex;
+        /**
+         * The handler currently run by this worker. Guarded by handlerMutex of the scheduler.
+         */
+        CEGISHandler * handler = nullptr;
+    };
+
+    /**
+     * All workers of the pool.
+     */
+    std::vector<std::unique_ptr<Worker>> workers;
+    /**
+     * Number of submitted but not yet completed tasks.
+     */
+    size_t pending = 0;
+    /**
+     * Worker to enqueue the next submitted task at.
+     */
+    size_t next = 0;
+    /**
+     * Guards pending and next, signalled whenever tasks are submitted or completed.
+     */
+    std::mutex poolMutex;
+    std::condition_variable poolCv;
+    /**
+     * Serializes invocations of the result callback.
+     */
+    std::mutex callbackMutex;
+    /**
+     * Guards the handler pointers of the workers.
+     */
+    std::mutex handlerMutex;
+    /**
+     * Flag set by cancel().
+     */
+    std::atomic<bool> cancelled{false};
+
+    /**
+     * Takes the next task for the given worker, either from its own queue or stolen from another one.
+     *
+     * @param index Index of the worker looking for a task.
+     * @param task Set to the found task.
+     * @return true iff a task was found.
+     */
+    bool take(size_t index, Task & task);
+
+    /**
+     * Main loop of a worker. Executes tasks until none are pending anymore.
+     *
+     * @param index Index of the worker.
+     * @param callback Receives the results.
+     */
+    void work(size_t index, const ResultCallback & callback);
+
+public:
+    /**
+     * Constructor. Creates a pool of the given size. Uses all available cores by default.
+     *
+     * @param size Number of workers.
+     */
+    explicit CEGISScheduler(size_t size = std::thread::hardware_concurrency());
+
+    /**
+     * Adds a task to the queue. Can be called before run() and while it is running, e.g. from the result
+     * callback.
+     *
+     * @param task The task to be added.
+     */
+    void submit(const Task & task);
+
+    /**
+     * Executes all submitted tasks and streams their results to the given callback. Blocks until all tasks
+     * (including those submitted while running) are completed or the scheduler was cancelled.
+     *
+     * @param callback Receives the result of each task as soon as it completes.
+     */
+    void run(const ResultCallback & callback);
+
+    /**
+     * Cancels all running tasks and discards the pending ones. Safe to be called from any thread.
+     */
+    void cancel();
+
+    /**
+     * Returns the number of workers.
+     *
+     * @return The number of workers.
+     */
+    size_t size() const;
+};
+
+#endif //CEGIS_CEGISSCHEDULER_H
@@ -0,0 +1,248 @@
+//
+// Created by marcel on 16.10.26.
+//
+
+#ifndef CEGIS_PROCESSPORTFOLIO_H
+#define CEGIS_PROCESSPORTFOLIO_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <iostream>
+#include <unordered_map>
+#include <sys/types.h>
+#include <boost/optional.hpp>
+#include <z3++.h>
+
+/**
+ * A portfolio of solvers living in separate worker processes, each with its own address space and Z3 heap. The
+ * workers are instances of the cegis_worker executable connected via Unix domain sockets. Assertions are shipped
+ * as SMT-LIB2 once, afterwards only push, pop and check commands and the resulting models are exchanged. As in
+ * SolverPortfolio, a call to check() lets all workers race with different random seeds, the first definite answer
+ * wins and all other workers are interrupted (by SIGINT).
+ *
+ * Every worker is restarted transparently if it dies, e.g. because it crashed or exceeded its memory limit. The
+ * assertion stack is kept as a journal of commands and replayed to the new process, after which the interrupted
+ * check is repeated once.
+ *
+ * The protocol is line based. A worker greets with ready, afterwards every command is answered by exactly one
+ * reply:
+ *
+ *     assert <n>\n<n bytes of SMT-LIB2>  ->  ok | error <message>
+ *     push | pop                         ->  ok
+ *     timeout <ms>                       ->  ok
+ *     check                              ->  sat | unsat | unknown
+ *     model                              ->  model <k>\n followed by k lines <name>\t<value>
+ *
+ * Fields are separated by tabs. The portfolio must be driven from a single thread. Only interrupt() may be called
+ * concurrently.
+ */
+class ProcessPortfolio {
+
+private:
+    /**
+     * The parent's end of a single worker process.
+     */
+    struct Worker {
+        /**
+         * Process id of the worker. 0 iff the worker is not running.
+         */
+        pid_t pid = 0;
+        /**
+         * The parent's end of the socket pair.
+         */
+        int fd = -1;
+        /**
+         * Received but not yet consumed bytes.
+         */
+        std::string buffer;
+        /**
+         * Random seed passed to the worker.
+         */
+        unsigned seed = 0;
+        /**
+         * Number of consecutive failed attempts to (re)start the worker. The worker is given up after a few.
+         */
+        unsigned failures = 0;
+    };
+
+    /**
+     * All workers of the portfolio.
+     */
+    std::vector<Worker> workers;
+    /**
+     * Path to the worker executable.
+     */
+    const std::string executable;
+    /**
+     * Memory limit per worker in megabytes. 0 iff unlimited.
+     */
+    const size_t memoryLimit;
+    /**
+     * All commands establishing the current assertion stack, replayed to restarted workers.
+     */
+    std::vector<std::string> journal;
+    /**
+     * The latest timeout command, replayed to restarted workers. Empty iff no timeout was set.
+     */
+    std::string timeoutCommand;
+    /**
+     * Uninterpreted constants of all asserted expressions by their names. Used to read back models.
+     */
+    std::unordered_map<std::string, z3::func_decl> constants;
+    /**
+     * Index of the worker that answered the latest check() call first. Equals workers.size() iff no worker
+     * was able to give a definite answer.
+     */
+    size_t winner;
+    /**
+     * Number of worker restarts so far.
+     */
+    size_t restarts = 0;
+    /**
+     * Guards the process ids against concurrent calls of interrupt().
+     */
+    std::mutex interruptMutex;
+
+    /**
+     * Starts the given worker and replays the journal to it.
+     *
+     * @param w The worker.
+     * @return true iff the worker is running and in sync.
+     */
+    bool start(Worker & w);
+
+    /**
+     * Terminates the given worker if it is running.
+     *
+     * @param w The worker.
+     */
+    void stop(Worker & w);
+
+    /**
+     * Sends a command to the given worker.
+     *
+     * @param w The worker.
+     * @param command The command including its trailing newline.
+     * @return true iff the command was sent completely.
+     */
+    bool send(Worker & w, const std::string & command);
+
+    /**
+     * Reads the next line from the given worker. Blocks until a complete line is available.
+     *
+     * @param w The worker.
+     * @param line Set to the line without its newline.
+     * @return true iff a line was read, false iff the worker died.
+     */
+    bool receive(Worker & w, std::string & line);
+
+    /**
+     * Sends a command changing the state of the workers to all of them and waits for their acknowledgements.
+     * Dead workers are restarted. The command has to be recorded in the journal or as timeout command before.
+     *
+     * @param command The command including its trailing newline.
+     */
+    void broadcast(const std::string & command);
+
+public:
+    /**
+     * Constructor. Starts the given number of worker processes. Worker i uses random seed i.
+     *
+     * @param size Number of worker processes.
+     * @param exe Path to the cegis_worker executable. Looked up in PATH if it contains no slash.
+     * @param megabytes Memory limit per worker in megabytes. 0 for no limit.
+     */
+    ProcessPortfolio(size_t size, const std::string & exe = "cegis_worker", size_t megabytes = 0);
+
+    /**
+     * Destructor. Terminates all workers.
+     */
+    ~ProcessPortfolio();
+
+    ProcessPortfolio(const ProcessPortfolio &) = delete;
+    ProcessPortfolio & operator=(const ProcessPortfolio &) = delete;
+
+    /**
+     * Serializes the given expression to SMT-LIB2 and asserts it in every worker.
+     *
+     * @param e Expression to be asserted.
+     */
+    void add(const z3::expr & e);
+
+    /**
+     * Drops all assertions by clearing the journal and restarting all workers. The timeout is kept.
+     */
+    void reset();
+
+    /**
+     * Creates a backtracking point in all workers.
+     */
+    void push();
+
+    /**
+     * Backtracks one level in all workers.
+     */
+    void pop();
+
+    /**
+     * Runs all workers concurrently on their assertions. Returns as soon as the first worker found a definite
+     * answer; the remaining ones are interrupted.
+     *
+     * @return z3::sat or z3::unsat as determined by the fastest worker, z3::unknown iff no worker succeeded.
+     */
+    z3::check_result check();
+
+    /**
+     * Returns the model found by the winner of the latest check() call in the given context. Only constants
+     * occurring in asserted expressions are assigned. The latest check() call must have returned z3::sat.
+     *
+     * @param ctx Context into which the model should be read.
+     * @return The winner's model, boost::none iff the winner died before handing it out.
+     */
+    boost::optional<z3::model> getModel(z3::context & ctx);
+
+    /**
+     * Sets a timeout for all further checks of all workers.
+     *
+     * @param ms Timeout in milliseconds.
+     */
+    void setTimeout(unsigned ms);
+
+    /**
+     * Interrupts all workers. Can be called from any thread.
+     */
+    void interrupt();
+
+    /**
+     * Returns the number of workers.
+     *
+     * @return The number of workers.
+     */
+    size_t size() const;
+
+    /**
+     * Returns the number of worker restarts so far.
+     *
+     * @return The number of restarts.
+     */
+    size_t getRestarts() const;
+
+    /**
+     * Worker side of the protocol. Reads commands from in and writes replies to out until in is closed. Called by
+     * the cegis_worker executable with its standard streams. Exits the process with a non-zero status iff the
+     * memory limit was exceeded, so that the parent starts a fresh one. A check exceeding it is not answered, as
+     * its model could not be handed out anymore, but repeated by the parent on the fresh process. A check that was interrupted or answered
+     * unknown replaces the solver by a fresh one that receives all assertions and backtracking points again.
+     *
+     * @param in Command stream.
+     * @param out Reply stream.
+     * @param seed Random seed of the solver.
+     * @param megabytes Memory limit of Z3 in megabytes. 0 for no limit.
+     * @return Exit status of the worker.
+     */
+    static int serve(std::istream & in, std::ostream & out, unsigned seed, size_t megabytes);
+};
+
+#endif //CEGIS_PROCESSPORTFOLIO_H
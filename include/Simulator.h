@@ -0,0 +1,248 @@
+//
+// Created by marcel on 16.10.26.
+//
+
+#ifndef CEGIS_SIMULATOR_H
+#define CEGIS_SIMULATOR_H
+
+#include <vector>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+#include <z3++.h>
+
+/**
+ * Concrete evaluator for the Boolean and bit-vector fragment (up to 64 bits per term) of a CEGIS specification.
+ * The behavioral and correctness constraints are compiled once into a flat program over the DAG of the
+ * expression. Helper variables have to be defined by top-level conjuncts of the behavioral constraints of the form
+ * h == f(...); all other conjuncts are kept as constraints. Each program slot holds one 64 bit word per lane and
+ * every instruction is a tight loop over all lanes, so a single evaluation checks a whole batch of inputs at once.
+ *
+ * If all terms are single bits, e.g. for logic synthesis, the program is evaluated on packed truth tables
+ * instead, i.e. each word holds 64 input valuations and every instruction is a single bitwise operation.
+ *
+ * A lane fails iff the behavioral constraints hold but the correctness constraints do not, i.e. its input
+ * valuation is a counter example to the current implementation.
+ */
+class Simulator {
+
+private:
+    /**
+     * A single instruction of the compiled program. Its result is stored in the slot of the same index.
+     */
+    struct Instruction {
+        /**
+         * The operation. Z3_OP_UNINTERPRETED denotes an implementation or input variable, Z3_OP_BNUM a constant.
+         */
+        Z3_decl_kind kind;
+        /**
+         * Width of the result in bits. 1 for Boolean results.
+         */
+        unsigned width;
+        /**
+         * Slots of the operands.
+         */
+        std::vector<unsigned> args;
+        /**
+         * Integer parameters of the operation, e.g. the bounds of an extraction.
+         */
+        unsigned high, low;
+        /**
+         * Value of a constant.
+         */
+        uint64_t value;
+    };
+
+    /**
+     * The compiled program in topological order.
+     */
+    std::vector<Instruction> program;
+    /**
+     * The values of all slots, lanes words per slot.
+     */
+    std::vector<uint64_t> values;
+    /**
+     * Number of words per slot.
+     */
+    const size_t lanes;
+    /**
+     * Slots of the implementation and input variables, parallel to the given variable vectors.
+     */
+    std::vector<unsigned> implementationSlots, inputSlots;
+    /**
+     * The input variables to build counter example models with.
+     */
+    const z3::expr_vector inputVariables;
+    /**
+     * Slot holding 1 for every failing lane.
+     */
+    unsigned failureSlot = 0;
+    /**
+     * Flag indicating whether the specification lies within the supported fragment.
+     */
+    bool compiled = false;
+    /**
+     * Flag indicating whether every word holds 64 single bit samples instead of one sample.
+     */
+    bool packed = false;
+    /**
+     * Source of the random inputs.
+     */
+    std::mt19937_64 random;
+
+    /**
+     * Slot of every compiled expression by its AST id.
+     */
+    std::unordered_map<unsigned, unsigned> slots;
+    /**
+     * Defining expression of every helper variable by the helper's AST id.
+     */
+    std::unordered_map<unsigned, z3::expr> definitions;
+    /**
+     * AST ids of the implementation and input variables.
+     */
+    std::unordered_set<unsigned> variables;
+    /**
+     * AST ids of the helpers whose definition is currently being compiled. Used to detect cyclic definitions.
+     */
+    std::unordered_set<unsigned> defining;
+
+    /**
+     * Compiles the given expression and all its subexpressions. Throws an exception iff the expression lies
+     * outside of the supported fragment.
+     *
+     * @param e Expression to be compiled.
+     * @return The slot holding the value of e.
+     */
+    unsigned compile(const z3::expr & e);
+
+    /**
+     * Appends an instruction to the program and reserves its slot.
+     *
+     * @param ins The instruction to be appended.
+     * @return The slot of the instruction.
+     */
+    unsigned append(const Instruction & ins);
+
+    /**
+     * Returns the lane words of the given slot.
+     *
+     * @param slot The slot.
+     * @return Pointer to the first lane.
+     */
+    uint64_t * lane(unsigned slot);
+
+    /**
+     * Executes the program on the current values of the variable slots.
+     */
+    void evaluate();
+
+    /**
+     * Executes the program on the current values of the variable slots, interpreting each word as 64 samples.
+     */
+    void evaluatePacked();
+
+    /**
+     * Returns whether the program consists of single bit operations only.
+     *
+     * @return true iff the program can be evaluated on packed truth tables.
+     */
+    bool isPackable() const;
+
+    /**
+     * Returns the value of the given slot in the given sample.
+     *
+     * @param slot The slot.
+     * @param index Index of the sample.
+     * @return The value of the slot.
+     */
+    uint64_t sample(unsigned slot, size_t index);
+
+    /**
+     * Builds models for the distinct failing samples among the first count samples of the latest evaluation.
+     *
+     * @param count Number of samples to inspect.
+     * @param maxFailures Maximum size of failures.
+     * @param failures Receives the input valuations of failing samples.
+     */
+    void collect(size_t count, size_t maxFailures, std::vector<z3::model> & failures);
+
+public:
+    /**
+     * Constructor. Compiles the given specification. Check isCompiled() to see whether it is supported.
+     *
+     * @param implVars The variables representing the sought implementation.
+     * @param inpVars The variables representing the possible inputs.
+     * @param hlpVars The variables representing the helpers.
+     * @param behavExpr Constraints ensuring correct internal behavior.
+     * @param corrExpr Constraints ensuring desired output or similar.
+     * @param n Number of lanes, i.e. words per slot, e.g. 64, 256 or 512.
+     * @param seed Seed for the random inputs.
+     */
+    Simulator(z3::expr_vector const & implVars,
+              z3::expr_vector const & inpVars,
+              z3::expr_vector const & hlpVars,
+              z3::expr        const & behavExpr,
+              z3::expr        const & corrExpr,
+              size_t                  n,
+              unsigned                seed = 0);
+
+    /**
+     * Returns whether the specification lies within the supported fragment, i.e. whether it can be simulated.
+     *
+     * @return true iff the specification was compiled successfully.
+     */
+    bool isCompiled() const;
+
+    /**
+     * Returns the number of lanes, i.e. the number of words per slot.
+     *
+     * @return The number of lanes.
+     */
+    size_t getLanes() const;
+
+    /**
+     * Returns the number of inputs evaluated at once, i.e. the number of lanes times 64 iff the truth tables are
+     * packed.
+     *
+     * @return The number of samples per evaluation.
+     */
+    size_t getSamples() const;
+
+    /**
+     * Returns whether the input space can be enumerated by exhaust(), i.e. whether all inputs are single bits
+     * and there are not more than the given number of them.
+     *
+     * @param maxInputs Maximum number of inputs.
+     * @return true iff exhaust() may be called.
+     */
+    bool isEnumerable(size_t maxInputs) const;
+
+    /**
+     * Sets the valuation of the implementation variables for all further simulations.
+     *
+     * @param valuation Numerals (or Boolean values) parallel to the implementation variables.
+     */
+    void setImplementation(const std::vector<z3::expr> & valuation);
+
+    /**
+     * Evaluates one batch of random inputs and returns the failing ones.
+     *
+     * @param maxFailures Maximum number of failing inputs to be returned.
+     * @return Models assigning the input variables of up to maxFailures distinct failing lanes.
+     */
+    std::vector<z3::model> falsify(size_t maxFailures);
+
+    /**
+     * Evaluates all 2^n valuations of the n single bit inputs, i.e. verifies the implementation. Stops as soon as
+     * enough failing minterms were found. Requires isEnumerable().
+     *
+     * @param maxFailures Maximum number of failing minterms to be returned.
+     * @return Models assigning the input variables of up to maxFailures failing minterms. Empty iff the
+     *         implementation is correct.
+     */
+    std::vector<z3::model> exhaust(size_t maxFailures);
+};
+
+#endif //CEGIS_SIMULATOR_H
@@ -0,0 +1,222 @@
+//
+// Created by marcel on 16.10.26.
+//
+
+#ifndef CEGIS_SOLVERPORTFOLIO_H
+#define CEGIS_SOLVERPORTFOLIO_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <z3++.h>
+
+/**
+ * A portfolio of solvers racing on the same formula. Every worker owns its own z3::context and z3::solver so
+ * that the workers can be run concurrently. All assertions are translated into each worker's context. A call to
+ * check() starts one thread per worker, the first definite answer (sat or unsat) wins and all other workers are
+ * interrupted. A solver whose check was interrupted (or gave up otherwise) is not trusted anymore: it is replaced by a
+ * fresh one that receives the worker's assertions and backtracking points again.
+ *
+ * The portfolio must be driven from a single thread. Only interrupt() may be called concurrently.
+ */
+class SolverPortfolio {
+
+private:
+    /**
+     * A single member of the portfolio consisting of its own context and solver.
+     */
+    struct Worker {
+        /**
+         * The context exclusively used by this worker.
+         */
+        z3::context context;
+        /**
+         * The solver working on the translated assertions.
+         */
+        z3::solver solver;
+        /**
+         * Tactic pipeline of the solver. Empty for the default solver.
+         */
+        const std::string tactic;
+        /**
+         * Random seed of the solver.
+         */
+        const unsigned seed;
+        /**
+         * Timeout of the solver in milliseconds. 0 iff none was set.
+         */
+        unsigned timeout = 0;
+        /**
+         * All translated assertions of the solver in the order they were added.
+         */
+        std::vector<z3::expr> assertions;
+        /**
+         * Number of assertions preceding each open backtracking point.
+         */
+        std::vector<size_t> scopes;
+
+        /**
+         * Constructor. Creates a solver from the given tactic pipeline (or the default solver iff it is empty)
+         * and seeds it with the given value.
+         *
+         * @param tactic Tactic pipeline, i.e. tactic names separated by ';'. Empty for the default solver.
+         * @param seed Random seed used for the solver.
+         */
+        Worker(const std::string & tactic, unsigned seed);
+
+        /**
+         * Replaces the solver by a fresh one built from the tactic pipeline and seed without any assertions.
+         */
+        void reset();
+
+        /**
+         * Replaces the solver by a fresh one built from the tactic pipeline, seed and timeout, and replays all
+         * assertions and backtracking points. Used after the solver's check was interrupted.
+         */
+        void rebuild();
+    };
+
+    /**
+     * All workers of the portfolio.
+     */
+    std::vector<std::unique_ptr<Worker>> workers;
+    /**
+     * Index of the worker that answered the latest check() call first. Equals workers.size() iff no worker
+     * was able to give a definite answer.
+     */
+    size_t winner;
+    /**
+     * Guards interrupt() against concurrent calls.
+     */
+    std::mutex interruptMutex;
+    /**
+     * Flag set by interrupt() and cleared by clearInterrupts(). Stops checkCubes() from handing out further cubes.
+     */
+    std::atomic<bool> interrupted{false};
+    /**
+     * Average runtime of the cubes solved by the latest checkCubes() call in microseconds.
+     */
+    long cubeRuntime = 0;
+    /**
+     * Number of cubes checked by the latest checkCubes() call.
+     */
+    size_t checkedCubes = 0;
+
+public:
+    /**
+     * Constructor. Creates the given number of workers. Worker i uses tactic pipeline tactics[i % tactics.size()]
+     * and random seed i. If no tactics are given, all workers use the default solver and differ in their seed only.
+     *
+     * @param size Number of workers, i.e. threads.
+     * @param tactics Tactic pipelines to distribute among the workers.
+     */
+    SolverPortfolio(size_t size, const std::vector<std::string> & tactics = {});
+
+    /**
+     * Translates the given expression into every worker's context and asserts it.
+     *
+     * @param e Expression to be asserted.
+     */
+    void add(const z3::expr & e);
+
+    /**
+     * Drops all assertions and the timeout of all workers by giving them fresh solvers. Their contexts are kept.
+     */
+    void reset();
+
+    /**
+     * Creates a backtracking point in all workers.
+     */
+    void push();
+
+    /**
+     * Backtracks one level in all workers.
+     */
+    void pop();
+
+    /**
+     * Runs all workers concurrently on their assertions. Returns as soon as the first worker found a definite
+     * answer; the remaining ones are interrupted and rebuilt.
+     *
+     * @return z3::sat or z3::unsat as determined by the fastest worker, z3::unknown iff no worker succeeded.
+     */
+    z3::check_result check();
+
+    /**
+     * Splits the search space into the 2^n cubes over the given n literals, i.e. all conjunctions of the literals
+     * or their negations, and solves them in parallel. Each worker repeatedly takes the next unsolved cube and
+     * checks its assertions under the cube as assumptions. The first cube found to be satisfiable stops all
+     * workers; its model can be obtained by getModel().
+     *
+     * @param splits Literals to split on. The cubes are enumerated with the first literal varying fastest.
+     * @return z3::sat iff a cube is satisfiable, z3::unsat iff all cubes are unsatisfiable, z3::unknown otherwise.
+     */
+    z3::check_result checkCubes(const std::vector<z3::expr> & splits);
+
+    /**
+     * Returns the average runtime of the cubes solved by the latest checkCubes() call.
+     *
+     * @return Average runtime in microseconds.
+     */
+    long getCubeRuntime() const;
+
+    /**
+     * Returns the number of cubes checked by the latest checkCubes() call, whatever their result.
+     *
+     * @return Number of checked cubes.
+     */
+    size_t getCheckedCubes() const;
+
+    /**
+     * Returns the model found by the winner of the latest check() or checkCubes() call translated into the given
+     * context. That call must have returned z3::sat.
+     *
+     * @param ctx Context into which the model should be translated.
+     * @return The winner's model.
+     */
+    z3::model getModel(z3::context & ctx) const;
+
+    /**
+     * Returns the statistics of the winner of the latest check() call, or of the first worker iff there was none.
+     *
+     * @return Solver statistics.
+     */
+    z3::stats statistics() const;
+
+    /**
+     * Returns the number of assertions of the first worker. All workers share the same assertions.
+     *
+     * @return Number of assertions.
+     */
+    size_t assertionCount() const;
+
+    /**
+     * Sets a timeout for all further checks of all workers.
+     *
+     * @param ms Timeout in milliseconds.
+     */
+    void setTimeout(unsigned ms);
+
+    /**
+     * Interrupts all workers. Can be called from any thread.
+     */
+    void interrupt();
+
+    /**
+     * Clears pending interrupts of all workers. An interrupt leaves a context canceled until its next check,
+     * which would make subsequent push() calls fail. Only the contexts are affected: the solvers whose checks were
+     * interrupted are rebuilt by check() and checkCubes() themselves.
+     */
+    void clearInterrupts();
+
+    /**
+     * Returns the number of workers.
+     *
+     * @return The number of workers.
+     */
+    size_t size() const;
+};
+
+#endif //CEGIS_SOLVERPORTFOLIO_H
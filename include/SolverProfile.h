@@ -0,0 +1,108 @@
+//
+// Created by marcel on 16.10.26.
+//
+
+#ifndef CEGIS_SOLVERPROFILE_H
+#define CEGIS_SOLVERPROFILE_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <iostream>
+#include <z3++.h>
+
+/**
+ * The two solver roles of the CEGIS routine.
+ */
+enum class SolverRole {
+    /**
+     * The solver looking for implementations consistent with all counter examples.
+     */
+    IMPLEMENTATION,
+    /**
+     * The solver looking for counter examples to an implementation.
+     */
+    COUNTER_EXAMPLE
+};
+
+/**
+ * Describes how to build a solver: a tactic pipeline and a set of parameters.
+ */
+struct SolverConfiguration {
+    /**
+     * Tactic names separated by ';', e.g. "simplify;bit-blast;sat". The default solver is used iff empty.
+     */
+    std::string tactic;
+    /**
+     * Solver parameters as name/value pairs, e.g. {"sat.restart", "luby"}. Values are interpreted as Booleans,
+     * unsigned integers, doubles or symbols, whichever fits first.
+     */
+    std::vector<std::pair<std::string, std::string>> parameters;
+
+    /**
+     * Creates a solver in the given context according to this configuration. Throws a z3::exception iff a tactic
+     * or parameter is unknown.
+     *
+     * @param ctx Context of the solver.
+     * @return The configured solver.
+     */
+    z3::solver makeSolver(z3::context & ctx) const;
+
+    /**
+     * Applies the parameters of this configuration to the given solver.
+     *
+     * @param s Solver to be configured.
+     */
+    void configure(z3::solver & s) const;
+
+    /**
+     * Returns a short human readable description, e.g. for logs.
+     *
+     * @return The tactic pipeline followed by all parameters.
+     */
+    std::string describe() const;
+};
+
+/**
+ * A configuration for each solver role. Profiles are written by the Autotuner and can be stored in and loaded
+ * from a simple line based text file:
+ *
+ *     cegis-profile 1
+ *     implementation tactic simplify;bit-blast;sat
+ *     implementation param sat.restart luby
+ *     counter-example param smt.relevancy 0
+ *
+ * Roles without lines use the default solver.
+ */
+struct SolverProfile {
+    /**
+     * The configurations of the implementation and the counter example solver.
+     */
+    SolverConfiguration implementation, counterExample;
+
+    /**
+     * Returns the configuration of the given role.
+     *
+     * @param role The role.
+     * @return Its configuration.
+     */
+    SolverConfiguration & operator[](SolverRole role);
+    const SolverConfiguration & operator[](SolverRole role) const;
+
+    /**
+     * Writes this profile in the file format described above.
+     *
+     * @param out Stream to write to.
+     */
+    void save(std::ostream & out) const;
+
+    /**
+     * Reads a profile in the file format described above. Throws a z3::exception iff the stream is malformed.
+     *
+     * @param in Stream to read from.
+     * @return The profile.
+     */
+    static SolverProfile load(std::istream & in);
+};
+
+#endif //CEGIS_SOLVERPROFILE_H
@@ -0,0 +1,75 @@
+//
+// Created by marcel on 16.10.26.
+//
+
+#ifndef CEGIS_TASKFILE_H
+#define CEGIS_TASKFILE_H
+
+#include <string>
+#include <memory>
+#include <z3++.h>
+#include "CEGIS.h"
+
+/**
+ * A synthesis task read from an SMT-LIB2 file. Variables are declared as usual and their roles are given by
+ * set-info attributes. The three constraint parts are nullary Boolean functions with fixed names:
+ *
+ *     (set-info :name adder-2)                                  ; optional, defaults to the file name
+ *     (declare-const x (_ BitVec 2))
+ *     ...
+ *     (set-info :cegis-implementation-variables (ls0 lc0 ls1 lc1))
+ *     (set-info :cegis-input-variables (x y))
+ *     (set-info :cegis-helper-variables (c0 s0 c1 s1 c2))      ; optional
+ *     (define-fun implementation () Bool ...)                   ; optional, defaults to true
+ *     (define-fun behavior () Bool ...)                         ; optional, defaults to true
+ *     (define-fun correctness () Bool ...)
+ *
+ * Further define-fun and define-sort commands can be used as abbreviations. Plain assertions are conjoined to the
+ * behavioral constraints. All other commands, e.g. set-option or check-sat, are ignored, so a task file stays a
+ * valid SMT-LIB2 script. The file is handed to Z3's parser in one go; only the top-level commands are scanned
+ * beforehand to extract the variable roles.
+ */
+class TaskFile {
+
+public:
+    /**
+     * Name of the task.
+     */
+    std::string name;
+    /**
+     * The variables of the task by their roles.
+     */
+    z3::expr_vector implementationVariables, inputVariables, helperVariables;
+    /**
+     * The constraint parts of the task.
+     */
+    z3::expr implementationExpression, behavioralExpression, correctnessExpression;
+
+    /**
+     * Constructor. Parses the given task. Throws a z3::exception iff the task is malformed.
+     *
+     * @param ctx Context in which all variables and constraints are created.
+     * @param text Content of the task file.
+     * @param defaultName Name of the task iff it does not set one itself.
+     */
+    TaskFile(z3::context & ctx, const std::string & text, const std::string & defaultName = "");
+
+    /**
+     * Reads and parses the task file at the given path. Throws a z3::exception iff the file cannot be read or is
+     * malformed.
+     *
+     * @param ctx Context in which all variables and constraints are created.
+     * @param path Path to the task file. Its name without directory and extension is the default task name.
+     * @return The parsed task.
+     */
+    static TaskFile load(z3::context & ctx, const std::string & path);
+
+    /**
+     * Creates a handler for the task. Its name is already set.
+     *
+     * @return A new handler working in the context of the task.
+     */
+    std::unique_ptr<CEGISHandler> makeHandler() const;
+};
+
+#endif //CEGIS_TASKFILE_H
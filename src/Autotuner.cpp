@@ -0,0 +1,90 @@
+//
+// Created by marcel on 16.10.26.
+//
+
+#include "Autotuner.h"
+#include <limits>
+
+Autotuner::Autotuner(unsigned timeout)
+        :
+        tasks{},
+        timeout{timeout}
+{}
+
+void Autotuner::addTask(const Task & task) { tasks.push_back(task); }
+
+void Autotuner::addCandidate(SolverRole role, const SolverConfiguration & config)
+{
+    candidates[static_cast<int>(role)].push_back(config);
+}
+
+std::vector<SolverConfiguration> Autotuner::defaultCandidates()
+{
+    return
+    {
+        {"",                                 {}},
+        {"qfbv",                             {}},
+        {"qffd",                             {}},
+        {"simplify;bit-blast;sat",           {}},
+        {"simplify;solve-eqs;bit-blast;sat", {}},
+        {"simplify;bit-blast;sat",           {{"sat.restart", "luby"}}},
+        {"simplify;bit-blast;sat",           {{"sat.phase", "always_false"}}},
+        {"",                                 {{"smt.relevancy", "0"}}}
+    };
+}
+
+long Autotuner::evaluate(const SolverProfile & profile, long bound) const
+{
+    long score = 0;
+    for (const auto & task : tasks)
+    {
+        z3::context c;
+        long runtime = 2l * timeout;
+        try
+        {
+            auto handler = task(c);
+            handler->setSolverProfile(profile);
+            handler->setTimeout(timeout);
+            auto result = handler->CEGISRoutine();
+            const auto reason = result.getStopReason();
+            if (reason == CEGISHandler::StopReason::SOLVED || reason == CEGISHandler::StopReason::UNREALIZABLE)
+                runtime = result.getRuntime();
+        }
+        // e.g. a tactic not applicable to the task
+        catch (const z3::exception &) {}
+
+        score += runtime;
+        if (score >= bound)
+            break;
+    }
+    return score;
+}
+
+SolverProfile Autotuner::tune(std::ostream * log) const
+{
+    SolverProfile best{};
+    for (auto role : {SolverRole::IMPLEMENTATION, SolverRole::COUNTER_EXAMPLE})
+    {
+        const auto & pool = candidates[static_cast<int>(role)].empty() ? defaultCandidates()
+                                                                       : candidates[static_cast<int>(role)];
+        auto bestScore = std::numeric_limits<long>::max();
+        auto winner = best[role];
+        for (const auto & candidate : pool)
+        {
+            auto profile = best;
+            profile[role] = candidate;
+            const auto score = evaluate(profile, bestScore);
+            if (log)
+                *log << (role == SolverRole::IMPLEMENTATION ? "implementation" : "counter-example") << ", "
+                     << candidate.describe() << ", " << (score >= bestScore ? "dropped" : std::to_string(score))
+                     << std::endl;
+            if (score < bestScore)
+            {
+                bestScore = score;
+                winner = candidate;
+            }
+        }
+        best[role] = winner;
+    }
+    return best;
+}
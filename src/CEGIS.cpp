@@ -3,122 +3,1769 @@
 //
 
 #include "CEGIS.h"
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <limits>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <numeric>
+
+namespace
+{
+    /**
+     * Runs the given function periodically on its own thread until destroyed.
+     */
+    class Watchdog {
+
+    private:
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool finished = false;
+        std::thread thread;
+
+    public:
+        explicit Watchdog(const std::function<void()> & poll)
+                :
+                thread{[this, poll]
+                {
+                    std::unique_lock<std::mutex> lock{mutex};
+                    while (!cv.wait_for(lock, std::chrono::milliseconds(5), [this] { return finished; }))
+                        poll();
+                }}
+        {}
+
+        ~Watchdog()
+        {
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                finished = true;
+            }
+            cv.notify_all();
+            thread.join();
+        }
+    };
+
+    /**
+     * Header line identifying counter example files.
+     */
+    const std::string STORE_MAGIC = "cegis-counterexamples 1";
+
+    /**
+     * Encodes a value as a compact string. Bit-vector, integer and real numerals are stored as decimal numbers,
+     * everything else in SMT-LIB2 syntax.
+     */
+    std::string encodeValue(const z3::expr & value)
+    {
+        if (value.is_bool())
+            return value.is_true() ? "1" : "0";
+        if (value.is_numeral())
+            return Z3_get_numeral_string(value.ctx(), value);
+        return value.to_string();
+    }
+
+    /**
+     * Decodes a value stored by encodeValue() for a variable of the given sort.
+     */
+    z3::expr decodeValue(z3::context & ctx, const z3::expr & var, const std::string & value)
+    {
+        const auto sort = var.get_sort();
+        if (sort.is_bool())
+            return ctx.bool_val(value == "1");
+        if (sort.is_bv())
+            return ctx.bv_val(value.c_str(), sort.bv_size());
+        if (sort.is_int())
+            return ctx.int_val(value.c_str());
+        if (sort.is_real())
+            return ctx.real_val(value.c_str());
+
+        // fall back to Z3's parser for all other sorts
+        z3::sort_vector sorts{ctx};
+        z3::func_decl_vector decls{ctx};
+        decls.push_back(var.decl());
+        const std::string smt = "(assert (= " + var.decl().name().str() + " " + value + "))";
+        return ctx.parse_string(smt.c_str(), sorts, decls)[0].arg(1);
+    }
+
+    /**
+     * Collects the top-level conjuncts of the given expression.
+     */
+    void flattenConjunction(const z3::expr & e, std::vector<z3::expr> & conjuncts)
+    {
+        if (e.is_app() && e.decl().decl_kind() == Z3_OP_AND)
+        {
+            for (auto i = 0u; i < e.num_args(); ++i)
+                flattenConjunction(e.arg(i), conjuncts);
+        }
+        else if (!e.is_true())
+            conjuncts.push_back(e);
+    }
+
+    /**
+     * Returns whether the given constant occurs in the given expression.
+     */
+    bool occurs(const z3::expr & e, const z3::expr & constant)
+    {
+        std::unordered_set<unsigned> visited;
+        std::vector<z3::expr> stack{e};
+        while (!stack.empty())
+        {
+            auto top = stack.back();
+            stack.pop_back();
+            if (top.id() == constant.id())
+                return true;
+            if (!top.is_app() || !visited.insert(top.id()).second)
+                continue;
+            for (auto i = 0u; i < top.num_args(); ++i)
+                stack.push_back(top.arg(i));
+        }
+        return false;
+    }
+
+    const char * stopReasonName(CEGISHandler::StopReason reason)
+    {
+        switch (reason)
+        {
+            case CEGISHandler::StopReason::SOLVED:                return "solved";
+            case CEGISHandler::StopReason::UNREALIZABLE:          return "unrealizable";
+            case CEGISHandler::StopReason::TIMEOUT:               return "timeout";
+            case CEGISHandler::StopReason::COUNTER_EXAMPLE_LIMIT: return "counter example limit";
+            case CEGISHandler::StopReason::MEMORY_LIMIT:          return "memory limit";
+            case CEGISHandler::StopReason::CANCELLED:             return "cancelled";
+            case CEGISHandler::StopReason::ERROR:                 return "error";
+            default:                                              return "unknown";
+        }
+    }
+
+    const char * verifierName(CEGISHandler::Verifier verifier)
+    {
+        switch (verifier)
+        {
+            case CEGISHandler::Verifier::SOLVER:       return "solver";
+            case CEGISHandler::Verifier::PORTFOLIO:    return "portfolio";
+            case CEGISHandler::Verifier::CUBES:        return "cubes";
+            case CEGISHandler::Verifier::PROCESSES:    return "processes";
+            case CEGISHandler::Verifier::PIPELINE:     return "pipeline";
+            case CEGISHandler::Verifier::SIMULATION:   return "simulation";
+            case CEGISHandler::Verifier::TRUTH_TABLES: return "truth tables";
+            default:                                   return "none";
+        }
+    }
+
+    /**
+     * Escapes a string for use within a JSON string literal, i.e. quotes, backslashes and control characters.
+     */
+    std::string escapeJson(const std::string & s)
+    {
+        std::ostringstream escaped;
+        for (auto ch : s)
+        {
+            if (ch == '"' || ch == '\\')
+                escaped << '\\' << ch;
+            else if (static_cast<unsigned char>(ch) < 0x20)
+                escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(ch);
+            else
+                escaped << ch;
+        }
+        return escaped.str();
+    }
+}
 
 // ***********************************************************
 // ******************* CEGISHandler **************************
 // ***********************************************************
 
-size_t CEGISHandler::ceID = 0;
+CEGISHandler::CEGISHandler(z3::context   * const   ctx,
+                           z3::expr_vector const & implVars,
+                           z3::expr_vector const & inpVars,
+                           z3::expr_vector const & hlpVars,
+                           z3::expr        const & implExpr,
+                           z3::expr        const & behavExpr,
+                           z3::expr        const & corrExpr)
+        :
+        context{ctx},
+        implementationVariables{implVars},
+        inputVariables{inpVars},
+        helperVariables{hlpVars},
+        implementationExpression{implExpr},
+        behavioralExpression{behavExpr},
+        correctnessExpression{corrExpr},
+        implementationSolver{*context},
+        counterExampleSolver{*context},
+        counterExamplePortfolio{},
+        counterExampleProcesses{},
+        implementationPortfolio{},
+        store{std::make_shared<CounterExampleStore>(inputVariables)},
+        counterExamples{},
+        generalizationSolver{*context},
+        renamer{context, inputVariables, helperVariables, behavioralExpression && correctnessExpression}
+{}
+
+const CEGISHandler::CEGISResult CEGISHandler::CEGISRoutine()
+{
+    if (!initialized)
+    {
+        // creates the counter example portfolio iff needed, hence before the verifier is set up
+        if (cubeDepth && !counterExampleProcesses)
+            initializeSplits();
+        if (preprocessing)
+            preprocess();
+        initializeSolvers();
+        initializeSimulator();
+        initialized = true;
+    }
+    else if (solversInterrupted)
+        initializeSolvers();
+
+    auto start = clock::now();
+    deadline = timeout ? start + std::chrono::milliseconds(timeout) : clock::time_point::max();
+    iterations.clear();
+
+    boost::optional<CEGISResult> result;
+    {
+        // lets cancel() interrupt the solvers while the loop runs, even if it throws
+        struct Running {
+            CEGISHandler & handler;
+            explicit Running(CEGISHandler & h) : handler(h)
+            {
+                std::lock_guard<std::mutex> lock{handler.runMutex};
+                handler.running = true;
+            }
+            ~Running()
+            {
+                std::lock_guard<std::mutex> lock{handler.runMutex};
+                handler.running = false;
+            }
+        } running{*this};
+
+        // interrupts running checks as soon as the budget is exhausted
+        Watchdog watchdog{[this]
+        {
+            StopReason reason;
+            if (budgetExhausted(reason))
+                interruptSolvers();
+        }};
+
+        result.emplace(asyncVerifier && !implementationPortfolio ? runPipeline(start) : runLoop(start));
+    }
+
+    // interrupts leave the contexts canceled until their next check
+    z3::solver{*context, z3::solver::simple()}.check();
+    if (implementationPortfolio)
+        implementationPortfolio->clearInterrupts();
+    if (counterExamplePortfolio)
+        counterExamplePortfolio->clearInterrupts();
+    if (asyncVerifier)
+        asyncVerifier->clearInterrupts();
+
+    // e.g. a solver reached its timeout, which cancels it just like an interrupt
+    const auto reason = result.get().getStopReason();
+    if (reason != StopReason::SOLVED && reason != StopReason::UNREALIZABLE &&
+        reason != StopReason::COUNTER_EXAMPLE_LIMIT)
+        solversInterrupted = true;
+
+    if (reason == StopReason::CANCELLED)
+        cancelled = false;
+
+    return result.get();
+}
+
+size_t CEGISHandler::enumerateImplementations(const std::function<bool(const CEGISResult &)> & callback, size_t k)
+{
+    size_t found = 0;
+    while (!k || found < k)
+    {
+        auto result = CEGISRoutine();
+        if (result.getStopReason() != StopReason::SOLVED)
+            break;
+
+        ++found;
+        if (!callback(result))
+            break;
+
+        // exclude the found implementation from all further searches
+        z3::expr_vector valuation{*context};
+        for (auto i = 0u; i < implementationVariables.size(); ++i)
+            valuation.push_back(implementationVariables[i] == result.getValuation(implementationVariables[i], true));
+        blockedImplementations.push_back(!z3::mk_and(valuation));
+        implementationAdd(blockedImplementations.back());
+    }
+
+    return found;
+}
+
+void CEGISHandler::strengthenImplementation(const z3::expr & constraint)
+{
+    implementationExpression = implementationExpression && constraint;
+    if (initialized)
+        implementationAdd(constraint);
+}
+
+size_t CEGISHandler::setCorrectness(const z3::expr & corrExpr)
+{
+    correctnessExpression = corrExpr;
+
+    // drop the counter examples whose inputs no longer demand anything, e.g. outside the premise of a property;
+    // the kept ones move to a new store as results index the store by position, earlier results keep the old one
+    auto previous = store;
+    store = std::make_shared<CounterExampleStore>(inputVariables);
+    std::vector<CounterExample> kept{};
+    for (const auto & ce : counterExamples)
+    {
+        z3::expr_vector values{*context};
+        for (auto i = 0u; i < inputVariables.size(); ++i)
+            values.push_back(ce.getValue(i));
+        if (!z3::expr(correctnessExpression).substitute(inputVariables, values).simplify().is_true())
+            kept.emplace_back(*store, store->add(*previous, ce.getNumber()));
+    }
+    counterExamples = kept;
+    counterExampleIndex.clear();
+    orbitIndex.clear();
+    if (!symmetryGroups.empty())
+    {
+        for (const auto & ce : counterExamples)
+            counterExampleIndex.insert(store->key(ce.getNumber()));
+    }
+
+    refutedImplementations.clear();
+    generalizations.clear();
+    costBounds.clear();
+
+    if (preprocessing)
+        preprocess();
+    else
+        renamer.setSkeleton(helperVariables, behavioralExpression && correctnessExpression);
+
+    if (!initialized)
+        return counterExamples.size();
+
+    // instances of the old specification cannot be retracted selectively, hence both searches backtrack
+    initializeSolvers();
+    initializeSimulator();
+
+    return counterExamples.size();
+}
+
+CEGISHandler::StopReason CEGISHandler::minimize(const z3::expr & cost,
+                                                const std::function<bool(const CEGISResult &)> & callback,
+                                                CostSearch search)
+{
+    const bool bitVector = cost.is_bv();
+    auto atMost = [&](int64_t v)
+    {
+        return bitVector ? z3::ule(cost, context->bv_val(static_cast<uint64_t>(v), cost.get_sort().bv_size()))
+                         : cost <= context->int_val(v);
+    };
+    auto costOf = [&](const CEGISResult & result)
+    {
+        auto value = result.getValuation(cost, true);
+        return bitVector ? static_cast<int64_t>(value.get_numeral_uint64()) : value.get_numeral_int64();
+    };
+    auto addBound = [&](const z3::expr & bound)
+    {
+        costBounds.push_back(bound);
+        implementationAdd(bound);
+    };
+
+    // results are immutable, hence rebound via emplace
+    boost::optional<CEGISResult> result;
+    result.emplace(CEGISRoutine());
+    if (result.get().getStopReason() != StopReason::SOLVED)
+        return result.get().getStopReason();
+
+    // lowest cost not ruled out yet, known for unsigned costs only
+    boost::optional<int64_t> lower;
+    if (bitVector)
+        lower = 0;
+    const bool binary = search == CostSearch::BINARY && !implementationPortfolio;
+    int64_t step = 1;
+
+    while (true)
+    {
+        if (!callback(result.get()))
+            return StopReason::CANCELLED;
+
+        auto best = costOf(result.get());
+        if (lower && lower.get() >= best)
+            return StopReason::SOLVED;
+        // only improving implementations are of interest from now on
+        addBound(atMost(best - 1));
+
+        while (true)
+        {
+            auto bound = best - 1;
+            if (binary && lower)
+                bound = lower.get() + (best - 1 - lower.get()) / 2;
+            else if (binary)
+                bound = best - step;
+
+            if (bound < best - 1)
+            {
+                costAssumption = context->bool_const(("cost_" + std::to_string(costBounds.size())).c_str());
+                addBound(z3::implies(costAssumption.get(), atMost(bound)));
+            }
+            result.emplace(CEGISRoutine());
+            costAssumption.reset();
+
+            if (result.get().getStopReason() == StopReason::SOLVED)
+            {
+                step *= 2;
+                break;
+            }
+            if (result.get().getStopReason() != StopReason::UNREALIZABLE)
+                return result.get().getStopReason();
+
+            // no correct implementation within the bound
+            if (bound == best - 1)
+                return StopReason::SOLVED;
+            lower = bound + 1;
+            addBound(!atMost(bound));
+        }
+    }
+}
+
+const CEGISHandler::CEGISResult CEGISHandler::runLoop(const clock::time_point & start)
+{
+    auto stop = [&](const ImplementationPair & implP, StopReason reason)
+    {
+        return CEGISResult(implP, store, counterExamples.size(), start, clock::now(), name, iterations, reason);
+    };
+    const auto none = std::make_pair(boost::optional<Implementation>(), z3::unknown);
+    // distinguishes exhausted budgets from genuine unknowns
+    auto unknown = [&]
+    {
+        StopReason reason;
+        return stop(none, budgetExhausted(reason) ? reason : StopReason::UNKNOWN);
+    };
+    // verdicts are only accepted iff no solver was interrupted during the run, the next run starts over otherwise
+    auto accept = [&](const ImplementationPair & implP, StopReason reason)
+    {
+        return solversInterrupted ? unknown() : stop(implP, reason);
+    };
+
+    while (true) {
+        StopReason reason;
+        if (budgetExhausted(reason))
+            return stop(none, reason);
+        if (maxCounterExamples && counterExamples.size() >= maxCounterExamples)
+            return stop(none, StopReason::COUNTER_EXAMPLE_LIMIT);
+
+        try
+        {
+            if (collectStatistics)
+                iterations.emplace_back();
+
+            applyTimeout();
+            auto implTp = findImplementation();
+            if (getResult(implTp) == z3::sat) // another implementation was found
+            {
+                auto ceStart = collectStatistics ? clock::now() : clock::time_point{};
+                auto ceTp = findCounterExample(getImpl(implTp));
+                if (collectStatistics)
+                {
+                    iterations.back().counterExampleTime = elapsed(ceStart);
+                    iterations.back().counterExamples = getCEs(ceTp).size();
+                }
+
+                if (getResult(ceTp) == z3::sat) // further counter-examples were found
+                {
+                    recordCounterExamples(getCEs(ceTp));
+
+                    if (pruneInterval && !implementationPortfolio)
+                        refutedImplementations.push_back(
+                                getImpl(implTp).extractConstraints(implementationVariables, context));
+                } else if (getResult(ceTp) == z3::unsat) // no more counter-examples possible
+                {
+                    return accept(implTp, StopReason::SOLVED);
+                } else // the implementation could not be verified
+                {
+                    return unknown();
+                }
+            } else if (getResult(implTp) == z3::unsat) // no implementation possible
+            {
+                return accept(implTp, StopReason::UNREALIZABLE);
+            } else
+            {
+                return unknown();
+            }
+        }
+        catch (const z3::exception &)
+        {
+            // operations other than check() throw when interrupted, e.g. within a backtracking point
+            solversInterrupted = true;
+            discardPendingCounterExamples();
+            if (!budgetExhausted(reason))
+                throw;
+            return stop(none, reason);
+        }
+    }
+}
+
+const CEGISHandler::CEGISResult CEGISHandler::runPipeline(const clock::time_point & start)
+{
+    auto stop = [&](const ImplementationPair & implP, StopReason reason)
+    {
+        return CEGISResult(implP, store, counterExamples.size(), start, clock::now(), name, iterations, reason);
+    };
+    const auto none = std::make_pair(boost::optional<Implementation>(), z3::unknown);
+    auto unknown = [&]
+    {
+        StopReason reason;
+        return stop(none, budgetExhausted(reason) ? reason : StopReason::UNKNOWN);
+    };
+    auto accept = [&](const ImplementationPair & implP, StopReason reason)
+    {
+        return solversInterrupted ? unknown() : stop(implP, reason);
+    };
+
+    // never leave a job behind, e.g. if the budget is exhausted during a speculative implementation search
+    struct Drain {
+        AsyncVerifier & verifier;
+        z3::context   & ctx;
+        ~Drain()
+        {
+            if (!verifier.isRunning())
+                return;
+            verifier.interrupt();
+            std::vector<z3::model> discarded;
+            try
+            {
+                verifier.wait(ctx, discarded);
+            }
+            catch (const z3::exception &) {}
+        }
+    } drain{*asyncVerifier, *context};
+
+    // the implementation currently verified on the verification thread
+    boost::optional<Implementation> pending;
+    // running averages of both phases in microseconds, speculation only pays off if verification takes longer
+    long implementationAverage = 0, verificationAverage = 0;
+
+    auto merge = [&](const Implementation & impl, const std::vector<CounterExample> & ces)
+    {
+        if (coreGeneralization)
+            generalizeRefutation(impl, ces);
+        recordCounterExamples(ces);
+        if (pruneInterval)
+            refutedImplementations.push_back(impl.extractConstraints(implementationVariables, context));
+    };
+    // waits for the verdict on the pending implementation and merges its counter examples
+    auto settle = [&](std::vector<CounterExample> & ces)
+    {
+        auto waitStart = clock::now();
+        std::vector<z3::model> found;
+        auto verdict = asyncVerifier->wait(*context, found);
+        for (const auto & mdl : found)
+            ces.emplace_back(*store, store->add(mdl));
+        verificationAverage = (verificationAverage + asyncVerifier->getRuntime()) / 2;
+        if (collectStatistics)
+        {
+            // only the time spent waiting is not hidden by the pipeline
+            iterations.back().counterExampleTime = elapsed(waitStart);
+            iterations.back().counterExamples = ces.size();
+            iterations.back().verifier = Verifier::PIPELINE;
+        }
+
+        if (verdict == z3::sat)
+            merge(pending.get(), ces);
+        return verdict;
+    };
+
+    while (true) {
+        StopReason reason;
+        if (budgetExhausted(reason))
+            return stop(none, reason);
+        if (maxCounterExamples && counterExamples.size() >= maxCounterExamples)
+            return stop(none, StopReason::COUNTER_EXAMPLE_LIMIT);
+
+        try
+        {
+            if (collectStatistics)
+                iterations.emplace_back();
+
+            applyTimeout();
+            // speculative iff an implementation is pending, which is excluded by speculationAssumption then
+            auto implStart = clock::now();
+            auto implTp = findImplementation();
+            implementationAverage = (implementationAverage + elapsed(implStart)) / 2;
+            speculationAssumption.reset();
+
+            if (pending)
+            {
+                std::vector<CounterExample> ces;
+                auto verdict = settle(ces);
+                if (verdict == z3::unsat)
+                    return accept(std::make_pair(pending, z3::sat), StopReason::SOLVED);
+                if (verdict != z3::sat)
+                    return unknown();
+                pending.reset();
+
+                // the speculative implementation has to survive the new counter examples
+                if (getResult(implTp) == z3::sat && isConsistent(getImpl(implTp), ces) != z3::sat)
+                    continue;
+            }
+
+            if (getResult(implTp) == z3::unsat) // no implementation possible
+                return accept(implTp, StopReason::UNREALIZABLE);
+            if (getResult(implTp) != z3::sat)
+                return unknown();
+
+            const auto & impl = getImpl(implTp);
+            if (simulator)
+            {
+                // falsification by simulation is cheap enough to stay on this thread
+                std::vector<CounterExample> ces;
+                auto simulated = simulate(impl, ces);
+                if (simulated == z3::unsat)
+                    return accept(implTp, StopReason::SOLVED);
+                if (simulated == z3::sat)
+                {
+                    merge(impl, ces);
+                    continue;
+                }
+            }
+
+            std::vector<z3::expr> valuation;
+            for (auto i = 0u; i < implementationVariables.size(); ++i)
+                valuation.push_back(impl.getValuation(implementationVariables[i], true));
+            asyncVerifier->start(valuation, batchSize, remainingTime());
+            pending.emplace(impl);
+
+            if (verificationAverage >= implementationAverage)
+            {
+                // look for a different implementation meanwhile, without committing to impl being wrong
+                speculationAssumption = context->bool_const(("spec_" + std::to_string(speculations++)).c_str());
+                implementationAdd(z3::implies(speculationAssumption.get(),
+                                              !impl.extractConstraints(implementationVariables, context)));
+                continue;
+            }
+
+            // the verdict would arrive before a speculative implementation, hence wait for it right away
+            std::vector<CounterExample> ces;
+            auto verdict = settle(ces);
+            if (verdict == z3::unsat)
+                return accept(implTp, StopReason::SOLVED);
+            if (verdict != z3::sat)
+                return unknown();
+            pending.reset();
+        }
+        catch (const z3::exception &)
+        {
+            // operations other than check() throw when interrupted, e.g. within a backtracking point
+            solversInterrupted = true;
+            discardPendingCounterExamples();
+            if (!budgetExhausted(reason))
+                throw;
+            return stop(none, reason);
+        }
+    }
+}
+
+void CEGISHandler::discardPendingCounterExamples()
+{
+    // results index the store by position, hence stored counter examples that never reached the list would shift
+    // every later one
+    store->truncate(counterExamples.size());
+}
+
+void CEGISHandler::recordCounterExamples(const std::vector<CounterExample> & ces)
+{
+    assert(ces.empty() || ces.front().getNumber() == counterExamples.size());
+    counterExamples.insert(counterExamples.end(), ces.begin(), ces.end());
+    if (symmetryGroups.empty())
+        return;
+
+    for (const auto & ce : ces)
+        counterExampleIndex.insert(store->key(ce.getNumber()));
+
+    for (const auto & ce : ces)
+    {
+        const auto id = ce.getNumber();
+        auto less = [&](size_t a, size_t b) { return store->less(id, a, b); };
+
+        // input i takes the value of input sources[i]; sorting the values within each group yields the
+        // canonical form shared by the whole orbit
+        std::vector<size_t> sources(inputVariables.size());
+        std::iota(sources.begin(), sources.end(), 0);
+        std::vector<std::vector<size_t>> arrangements;
+        for (const auto & group : symmetryGroups)
+        {
+            auto sorted = group;
+            std::sort(sorted.begin(), sorted.end(), less);
+            arrangements.push_back(sorted);
+        }
+        auto arrange = [&]
+        {
+            for (auto g = 0u; g < symmetryGroups.size(); ++g)
+            {
+                for (auto j = 0u; j < symmetryGroups[g].size(); ++j)
+                    sources[symmetryGroups[g][j]] = arrangements[g][j];
+            }
+        };
+        arrange();
+        if (!orbitIndex.insert(store->key(id, sources)).second)
+            continue;
+
+        // enumerates the distinct arrangements odometer-like, a group wraps around to the sorted one when exhausted
+        auto advance = [&]
+        {
+            for (auto & arrangement : arrangements)
+            {
+                if (std::next_permutation(arrangement.begin(), arrangement.end(), less))
+                    return true;
+            }
+            return false;
+        };
+        size_t added = 0;
+        do
+        {
+            arrange();
+            if (counterExampleIndex.insert(store->key(id, sources)).second)
+            {
+                counterExamples.emplace_back(*store, store->add(*store, id, sources));
+                ++added;
+            }
+        } while (added < orbitLimit && advance());
+    }
+}
+
+z3::check_result CEGISHandler::isConsistent(const Implementation & impl, const std::vector<CounterExample> & ces)
+{
+    auto implCons = impl.extractConstraints(implementationVariables, context);
+    for (const auto & ce : ces)
+    {
+        // with inputs and implementation fixed, only the helpers remain to be propagated
+        generalizationSolver.push();
+        for (auto i = 0u; i < inputVariables.size(); ++i)
+            generalizationSolver.add(inputVariables[i] == ce.getValue(i));
+        generalizationSolver.add(implCons);
+        auto result = generalizationSolver.check();
+        generalizationSolver.pop();
+
+        if (result != z3::sat)
+            return result;
+    }
+    return z3::sat;
+}
+
+unsigned CEGISHandler::remainingTime() const
+{
+    if (!timeout)
+        return std::numeric_limits<unsigned>::max();
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now()).count();
+    return static_cast<unsigned>(std::max(left, 1L));
+}
+
+bool CEGISHandler::budgetExhausted(StopReason & reason) const
+{
+    if (cancelled)
+        reason = StopReason::CANCELLED;
+    else if (timeout && clock::now() >= deadline)
+        reason = StopReason::TIMEOUT;
+    else if (memoryLimit && Z3_get_estimated_alloc_size() / (1024 * 1024) >= memoryLimit)
+        reason = StopReason::MEMORY_LIMIT;
+    else
+        return false;
+
+    return true;
+}
+
+void CEGISHandler::applyTimeout()
+{
+    auto ms = remainingTime();
+    if (timeout)
+        timeoutApplied = true;
+    else if (timeoutApplied)
+        timeoutApplied = false;
+    else
+        return;
+
+    z3::params p{*context};
+    p.set("timeout", ms);
+    implementationSolver.set(p);
+    counterExampleSolver.set(p);
+    generalizationSolver.set(p);
+    if (implementationPortfolio)
+        implementationPortfolio->setTimeout(ms);
+    if (counterExamplePortfolio)
+        counterExamplePortfolio->setTimeout(ms);
+    if (counterExampleProcesses)
+        counterExampleProcesses->setTimeout(ms);
+}
+
+void CEGISHandler::interruptSolvers()
+{
+    solversInterrupted = true;
+    context->interrupt();
+    if (implementationPortfolio)
+        implementationPortfolio->interrupt();
+    if (counterExamplePortfolio)
+        counterExamplePortfolio->interrupt();
+    if (counterExampleProcesses)
+        counterExampleProcesses->interrupt();
+    if (asyncVerifier)
+        asyncVerifier->interrupt();
+}
+
+const CEGISHandler::ImplementationPair CEGISHandler::findImplementation()
+{
+    for (; instantiatedCounterExamples < counterExamples.size(); ++instantiatedCounterExamples)
+    {
+        const auto & ce = counterExamples[instantiatedCounterExamples];
+
+        // extract constraints from counter example
+        auto phaseStart = collectStatistics ? clock::now() : clock::time_point{};
+        auto counterExampleCons = ce.extractConstraints(renamer.getSymbols(ce.getNumber()), inputVariables.size(),
+                                                        context);
+        if (collectStatistics)
+        {
+            iterations.back().extractionTime += elapsed(phaseStart);
+            phaseStart = clock::now();
+        }
+
+        // substitute variables in behavior and correctness expression
+        auto subExpr = renamer.instantiate(ce.getNumber());
+        if (collectStatistics)
+            iterations.back().substitutionTime += elapsed(phaseStart);
+
+        if (pruneInterval && !implementationPortfolio)
+        {
+            // track the instance to be able to retire it later on
+            auto literal = context->bool_const(("act_" + std::to_string(ce.getNumber())).c_str());
+            trackingLiterals.push_back(literal);
+            activeCounterExamples.push_back(true);
+            implementationAdd(z3::implies(literal, counterExampleCons && subExpr));
+        }
+        else
+            implementationAdd(counterExampleCons && subExpr);
+    }
+
+    // prune only after the latest counter examples were instantiated as they block the latest implementation
+    if (pruneInterval && !implementationPortfolio && refutedImplementations.size() >= prunedAt + pruneInterval)
+    {
+        pruneCounterExamples();
+        prunedAt = refutedImplementations.size();
+    }
+
+    if (collectStatistics)
+    {
+        auto & record = iterations.back();
+        record.assertions = implementationPortfolio ? implementationPortfolio->assertionCount()
+                                                    : implementationSolver.assertions().size();
+        record.relabeled = renamer.getNumberOfVariables();
+        auto checkStart = clock::now();
+        auto result = implementationCheck();
+        record.implementationTime = elapsed(checkStart);
+        record.implementationStatistics = SolverStatistics::from(implementationPortfolio
+                                                                 ? implementationPortfolio->statistics()
+                                                                 : implementationSolver.statistics());
+        if (result == z3::sat)
+            return std::make_pair(Implementation(implementationModel()), z3::sat);
+        return std::make_pair(boost::optional<Implementation>(), result);
+    }
+
+    switch (implementationCheck())
+    {
+        case z3::sat:
+            return std::make_pair(Implementation(implementationModel()), z3::sat);
+        case z3::unsat:
+            return std::make_pair(boost::optional<Implementation>(), z3::unsat);
+        default:
+            return std::make_pair(boost::optional<Implementation>(), z3::unknown);
+    }
+}
+
+const CEGISHandler::CounterExamplePair CEGISHandler::findCounterExample(const Implementation & impl)
+{
+    std::vector<CounterExample> ces{};
+    auto simulated = simulator ? simulate(impl, ces) : z3::unknown;
+    if (simulated != z3::unknown)
+    {
+        if (simulated == z3::sat && coreGeneralization)
+            generalizeRefutation(impl, ces);
+        return std::make_pair(std::move(ces), simulated);
+    }
+
+    if (collectStatistics)
+        iterations.back().verifier = counterExampleProcesses  ? Verifier::PROCESSES
+                                   : !counterExamplePortfolio ? Verifier::SOLVER
+                                   : cubeDepth                ? Verifier::CUBES
+                                                              : Verifier::PORTFOLIO;
+
+    auto implCons = impl.extractConstraints(implementationVariables, context);
+    verifierPush();
+    verifierAdd(implCons);
+
+    auto result = verifierCheck();
+    auto mdl = result == z3::sat ? verifierModel() : boost::none;
+    // a verdict whose counter example got lost proves nothing
+    if (result == z3::sat && !mdl)
+        result = z3::unknown;
+    if (result == z3::sat)
+    {
+        ces.emplace_back(*store, store->add(mdl.get()));
+        // further distinct counter examples for the same implementation
+        while (ces.size() < batchSize)
+        {
+            verifierAdd(ces.back().extractBlockingConstraint(inputVariables, context));
+            if (verifierCheck() != z3::sat || !(mdl = verifierModel()))
+                break;
+            ces.emplace_back(*store, store->add(mdl.get()));
+        }
+
+        if (coreGeneralization)
+            generalizeRefutation(impl, ces);
+    }
+
+    // worker processes do not report statistics
+    if (collectStatistics && !counterExampleProcesses)
+        iterations.back().counterExampleStatistics = SolverStatistics::from(counterExamplePortfolio
+                                                                            ? counterExamplePortfolio->statistics()
+                                                                            : counterExampleSolver.statistics());
+    verifierPop();
+
+    return std::make_pair(std::move(ces), result);
+}
+
+z3::check_result CEGISHandler::simulate(const Implementation & impl, std::vector<CounterExample> & ces)
+{
+    std::vector<z3::expr> valuation{};
+    for (auto i = 0u; i < implementationVariables.size(); ++i)
+        valuation.push_back(impl.getValuation(implementationVariables[i], true));
+    simulator->setImplementation(valuation);
+
+    if (truthTables)
+    {
+        for (const auto & mdl : simulator->exhaust(batchSize))
+            ces.emplace_back(*store, store->add(mdl));
+        if (collectStatistics)
+            iterations.back().verifier = Verifier::TRUTH_TABLES;
+        return ces.empty() ? z3::unsat : z3::sat;
+    }
+
+    for (auto round = 0u; round < simulationRounds && ces.empty(); ++round)
+    {
+        for (const auto & mdl : simulator->falsify(batchSize))
+            ces.emplace_back(*store, store->add(mdl));
+    }
+
+    if (collectStatistics && !ces.empty())
+        iterations.back().verifier = Verifier::SIMULATION;
+    return ces.empty() ? z3::unknown : z3::sat;
+}
+
+void CEGISHandler::generalizeRefutation(const Implementation & impl, const std::vector<CounterExample> & ces)
+{
+    auto bits = impl.extractBitConstraints(implementationVariables, context);
+
+    z3::expr_vector literals{*context};
+    std::unordered_map<unsigned, unsigned> bitOf{};
+    for (auto i = 0u; i < bits.size(); ++i)
+    {
+        literals.push_back(context->bool_const(("gen_" + std::to_string(i)).c_str()));
+        bitOf.emplace(literals.back().id(), i);
+    }
+
+    for (const auto & ce : ces)
+    {
+        generalizationSolver.push();
+        for (auto i = 0u; i < inputVariables.size(); ++i)
+            generalizationSolver.add(inputVariables[i] == ce.getValue(i));
+        for (auto i = 0u; i < bits.size(); ++i)
+            generalizationSolver.add(z3::implies(literals[i], bits[i]));
+
+        // sat iff helpers exist making the implementation work on this input, i.e. nothing to generalize
+        if (generalizationSolver.check(literals) == z3::unsat)
+        {
+            auto core = generalizationSolver.unsat_core();
+            z3::expr_vector blocked{*context};
+            for (auto i = 0u; i < core.size(); ++i)
+                blocked.push_back(bits[bitOf.at(core[i].id())]);
+            generalizations.push_back(!z3::mk_and(blocked));
+            implementationAdd(generalizations.back());
+            if (collectStatistics)
+                ++iterations.back().generalizations;
+        }
+        generalizationSolver.pop();
+    }
+}
+
+void CEGISHandler::implementationAdd(const z3::expr & e)
+{
+    if (implementationPortfolio)
+        implementationPortfolio->add(e);
+    else
+        implementationSolver.add(e);
+}
+
+z3::check_result CEGISHandler::implementationCheck()
+{
+    if (implementationPortfolio)
+        return implementationPortfolio->check();
+    else if (pruneInterval || costAssumption || speculationAssumption)
+    {
+        auto assumptions = activeAssumptions();
+        if (costAssumption)
+            assumptions.push_back(costAssumption.get());
+        if (speculationAssumption)
+            assumptions.push_back(speculationAssumption.get());
+        return implementationSolver.check(assumptions);
+    }
+    else
+        return implementationSolver.check();
+}
+
+z3::expr_vector CEGISHandler::activeAssumptions() const
+{
+    z3::expr_vector assumptions{*context};
+    for (auto i = 0u; i < trackingLiterals.size(); ++i)
+    {
+        if (activeCounterExamples[i])
+            assumptions.push_back(trackingLiterals[i]);
+    }
+    return assumptions;
+}
+
+void CEGISHandler::pruneCounterExamples()
+{
+    auto assumptions = activeAssumptions();
+
+    // minimal cores keep the useful set small
+    z3::params p{*context};
+    p.set("core.minimize", true);
+    implementationSolver.set(p);
+
+    // collect the counter examples needed to rule out the implementations refuted since the latest pruning step;
+    // the ones refuted before stay blocked as their cores are never retired
+    bool complete = true;
+    std::vector<unsigned> cores;
+    for (auto j = prunedAt; j < refutedImplementations.size(); ++j)
+    {
+        implementationSolver.push();
+        implementationSolver.add(refutedImplementations[j]);
+        auto result = implementationSolver.check(assumptions);
+        if (result == z3::unsat)
+        {
+            auto core = implementationSolver.unsat_core();
+            for (auto i = 0u; i < core.size(); ++i)
+                cores.push_back(core[i].id());
+        }
+        implementationSolver.pop();
+
+        // keep everything if a refuted implementation cannot be shown to be blocked
+        if (result != z3::unsat)
+        {
+            complete = false;
+            break;
+        }
+    }
+
+    p.set("core.minimize", false);
+    implementationSolver.set(p);
+    if (!complete)
+        return;
+    usefulLiterals.insert(cores.begin(), cores.end());
+
+    for (auto i = 0u; i < trackingLiterals.size(); ++i)
+    {
+        if (activeCounterExamples[i] && !usefulLiterals.count(trackingLiterals[i].id()))
+        {
+            activeCounterExamples[i] = false;
+            ++retiredInstances;
+            if (collectStatistics)
+                ++iterations.back().retired;
+        }
+    }
+
+    if (retiredInstances >= rebuildThreshold)
+        rebuildImplementationSolver();
+}
+
+void CEGISHandler::rebuildImplementationSolver()
+{
+    implementationSolver = profile.implementation.makeSolver(*context);
+    implementationSolver.push();
+    implementationSolver.add(implementationExpression);
+    for (const auto & clause : generalizations)
+        implementationSolver.add(clause);
+    for (const auto & clause : blockedImplementations)
+        implementationSolver.add(clause);
+    for (const auto & bound : costBounds)
+        implementationSolver.add(bound);
+    timeoutApplied = false;
+
+    for (auto i = 0u; i < trackingLiterals.size(); ++i)
+    {
+        if (!activeCounterExamples[i])
+            continue;
+
+        const auto & ce = counterExamples[i];
+        auto counterExampleCons = ce.extractConstraints(renamer.getSymbols(ce.getNumber()), inputVariables.size(),
+                                                        context);
+        implementationSolver.add(z3::implies(trackingLiterals[i],
+                                             counterExampleCons && renamer.instantiate(ce.getNumber())));
+    }
+
+    retiredInstances = 0;
+}
+
+void CEGISHandler::preprocess()
+{
+    std::unordered_set<unsigned> helperIds{};
+    for (auto i = 0u; i < helperVariables.size(); ++i)
+        helperIds.insert(helperVariables[i].id());
+
+    std::vector<z3::expr> conjuncts{};
+    flattenConjunction(behavioralExpression && correctnessExpression, conjuncts);
+
+    // substitute helpers by their definitions; from and to always hold fully expanded definitions
+    z3::expr_vector from{*context}, to{*context};
+    std::vector<z3::expr> remaining{};
+    for (const auto & c : conjuncts)
+    {
+        if (c.is_app() && c.decl().decl_kind() == Z3_OP_EQ)
+        {
+            auto defined = false;
+            for (auto side = 0u; side < 2 && !defined; ++side)
+            {
+                const auto h = c.arg(side);
+                if (!helperIds.count(h.id()))
+                    continue;
+
+                auto definition = from.empty() ? c.arg(1 - side) : c.arg(1 - side).substitute(from, to);
+                if (occurs(definition, h))
+                    continue;
+
+                z3::expr_vector hv{*context}, dv{*context};
+                hv.push_back(h);
+                dv.push_back(definition);
+                z3::expr_vector expanded{*context};
+                for (auto i = 0u; i < to.size(); ++i)
+                    expanded.push_back(to[i].substitute(hv, dv));
+                to = expanded;
+                from.push_back(h);
+                to.push_back(definition);
+                helperIds.erase(h.id());
+                defined = true;
+            }
+            if (defined)
+                continue;
+        }
+        remaining.push_back(c);
+    }
+
+    z3::goal g{*context};
+    for (const auto & c : remaining)
+        g.add(from.empty() ? c : z3::expr(c).substitute(from, to));
+
+    // all three tactics preserve equivalence, hence the result can be instantiated as is
+    z3::tactic t = z3::tactic{*context, "simplify"} & z3::tactic{*context, "propagate-values"} &
+                   z3::tactic{*context, "ctx-simplify"};
+    auto result = t(g);
+    auto skeleton = result.size() == 1 ? result[0].as_expr() : g.as_expr();
+
+    z3::expr_vector helpers{*context};
+    for (auto i = 0u; i < helperVariables.size(); ++i)
+    {
+        if (helperIds.count(helperVariables[i].id()))
+            helpers.push_back(helperVariables[i]);
+    }
+    renamer.setSkeleton(helpers, skeleton);
+}
+
+void CEGISHandler::initializeGeneralizationSolver()
+{
+    generalizationSolver = z3::solver{*context};
+    if (coreGeneralization)
+    {
+        // small cores yield general blocking clauses
+        z3::params p{*context};
+        p.set("core.minimize", true);
+        generalizationSolver.set(p);
+    }
+}
+
+void CEGISHandler::initializeSolvers()
+{
+    // everything lives in one backtracking point above an empty base level, which is replaced by a fresh one
+    // unless the solvers were interrupted, those are replaced as a whole
+    if (initialized && !solversInterrupted)
+    {
+        implementationPop();
+        verifierPop();
+        generalizationSolver.pop();
+    }
+    else
+    {
+        if (initialized)
+        {
+            implementationReset();
+            verifierReset();
+        }
+        initializeGeneralizationSolver();
+    }
+    solversInterrupted = false;
+    implementationPush();
+    verifierPush();
+    generalizationSolver.push();
+
+    instantiatedCounterExamples = 0;
+    trackingLiterals.clear();
+    activeCounterExamples.clear();
+    retiredInstances = 0;
+    // the cores of earlier pruning steps refer to the old tracking literals
+    prunedAt = 0;
+    usefulLiterals.clear();
+
+    implementationAdd(implementationExpression);
+    for (const auto & clause : generalizations)
+        implementationAdd(clause);
+    for (const auto & clause : blockedImplementations)
+        implementationAdd(clause);
+    for (const auto & bound : costBounds)
+        implementationAdd(bound);
+
+    verifierAdd(behavioralExpression && !correctnessExpression);
+    if (coreGeneralization || pipelining)
+        generalizationSolver.add(behavioralExpression && correctnessExpression);
+    // the verification thread owns its context, hence it gets a new one
+    if (pipelining)
+        asyncVerifier.reset(new AsyncVerifier(implementationVariables, inputVariables,
+                                              behavioralExpression && !correctnessExpression,
+                                              profile.counterExample));
+}
+
+void CEGISHandler::initializeSimulator()
+{
+    simulator.reset();
+    truthTables = false;
+    if (!simulationLanes && !truthTableThreshold)
+        return;
+
+    simulator.reset(new Simulator(implementationVariables, inputVariables, helperVariables,
+                                  behavioralExpression, correctnessExpression,
+                                  simulationLanes ? simulationLanes : 64));
+    truthTables = simulator->isEnumerable(truthTableThreshold);
+    if (!simulator->isCompiled() || (!simulationLanes && !truthTables))
+        simulator.reset();
+}
+
+z3::model CEGISHandler::implementationModel()
+{
+    // translate the portfolio winner's model back to make it usable in the counter example search
+    if (implementationPortfolio)
+        return implementationPortfolio->getModel(*context);
+    else
+        return implementationSolver.get_model();
+}
+
+void CEGISHandler::implementationReset()
+{
+    if (implementationPortfolio)
+        implementationPortfolio->reset();
+    else
+        implementationSolver = profile.implementation.makeSolver(*context);
+    timeoutApplied = false;
+}
+
+void CEGISHandler::verifierReset()
+{
+    if (counterExampleProcesses)
+        counterExampleProcesses->reset();
+    else if (counterExamplePortfolio)
+        counterExamplePortfolio->reset();
+    else
+        counterExampleSolver = profile.counterExample.makeSolver(*context);
+    timeoutApplied = false;
+}
+
+void CEGISHandler::implementationPush()
+{
+    if (implementationPortfolio)
+        implementationPortfolio->push();
+    else
+        implementationSolver.push();
+}
+
+void CEGISHandler::implementationPop()
+{
+    if (implementationPortfolio)
+        implementationPortfolio->pop();
+    else
+        implementationSolver.pop();
+}
+
+void CEGISHandler::verifierPush()
+{
+    if (counterExampleProcesses)
+        counterExampleProcesses->push();
+    else if (counterExamplePortfolio)
+        counterExamplePortfolio->push();
+    else
+        counterExampleSolver.push();
+}
+
+void CEGISHandler::verifierAdd(const z3::expr & e)
+{
+    if (counterExampleProcesses)
+        counterExampleProcesses->add(e);
+    else if (counterExamplePortfolio)
+        counterExamplePortfolio->add(e);
+    else
+        counterExampleSolver.add(e);
+}
+
+z3::check_result CEGISHandler::verifierCheck()
+{
+    if (counterExampleProcesses)
+        return counterExampleProcesses->check();
+    else if (counterExamplePortfolio && cubeDepth)
+    {
+        const auto depth = std::min(cubeDepth, static_cast<unsigned>(splitLiterals.size()));
+        auto result = counterExamplePortfolio->checkCubes({splitLiterals.begin(), splitLiterals.begin() + depth});
+
+        if (collectStatistics)
+            iterations.back().cubes += counterExamplePortfolio->getCheckedCubes();
+
+        // refine while single cubes are hard, coarsen while they are trivial
+        const auto runtime = counterExamplePortfolio->getCubeRuntime();
+        if (runtime > 1000000 && cubeDepth < splitLiterals.size())
+            ++cubeDepth;
+        else if (runtime < 20000 && cubeDepth > minCubeDepth)
+            --cubeDepth;
+
+        return result;
+    }
+    else if (counterExamplePortfolio)
+        return counterExamplePortfolio->check();
+    else
+        return counterExampleSolver.check();
+}
+
+boost::optional<z3::model> CEGISHandler::verifierModel()
+{
+    // translate the portfolio winner's model back to make it usable in the implementationSolver
+    if (counterExampleProcesses)
+        return counterExampleProcesses->getModel(*context);
+    else if (counterExamplePortfolio)
+        return counterExamplePortfolio->getModel(*context);
+    else
+        return counterExampleSolver.get_model();
+}
+
+void CEGISHandler::verifierPop()
+{
+    if (counterExampleProcesses)
+        counterExampleProcesses->pop();
+    else if (counterExamplePortfolio)
+        counterExamplePortfolio->pop();
+    else
+        counterExampleSolver.pop();
+}
+
+void CEGISHandler::initializeSplits()
+{
+    if (!counterExamplePortfolio)
+        counterExamplePortfolio.reset(new SolverPortfolio(std::max(std::thread::hardware_concurrency(), 2u)));
+
+    std::vector<z3::expr> inputs{};
+    for (auto i = 0u; i < inputVariables.size(); ++i)
+    {
+        if (inputVariables[i].is_bv() || inputVariables[i].is_bool())
+            inputs.push_back(inputVariables[i]);
+    }
+    auto width = [](const z3::expr & e) { return e.is_bv() ? e.get_sort().bv_size() : 1u; };
+    std::stable_sort(inputs.begin(), inputs.end(), [&](const z3::expr & a, const z3::expr & b)
+    {
+        return width(a) > width(b);
+    });
+
+    // the i-th round takes the i-th most significant bit of every input still wide enough
+    splitLiterals.clear();
+    for (auto bit = 0u; splitLiterals.size() < 16; ++bit)
+    {
+        const auto before = splitLiterals.size();
+        for (const auto & x : inputs)
+        {
+            if (bit >= width(x) || splitLiterals.size() == 16)
+                continue;
+            if (x.is_bool())
+                splitLiterals.push_back(x);
+            else
+            {
+                const auto b = width(x) - 1 - bit;
+                splitLiterals.push_back(x.extract(b, b) == context->bv_val(1, 1));
+            }
+        }
+        if (splitLiterals.size() == before)
+            break;
+    }
+
+    // at least one cube per worker
+    while ((size_t{1} << minCubeDepth) < counterExamplePortfolio->size() && minCubeDepth < splitLiterals.size())
+        ++minCubeDepth;
+    cubeDepth = std::max(cubeDepth, minCubeDepth);
+}
+
+long CEGISHandler::elapsed(const clock::time_point & since)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - since).count();
+}
+
+const std::string CEGISHandler::specificationHash() const
+{
+    std::stringstream spec;
+    for (const auto * vars : {&implementationVariables, &inputVariables, &helperVariables})
+    {
+        for (auto i = 0u; i < vars->size(); ++i)
+            spec << (*vars)[i] << ' ' << (*vars)[i].get_sort() << ';';
+        spec << '|';
+    }
+    spec << implementationExpression << '|' << behavioralExpression << '|' << correctnessExpression;
+
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (const char ch : spec.str())
+    {
+        hash ^= static_cast<unsigned char>(ch);
+        hash *= 1099511628211ull;
+    }
 
-CEGISHandler::CEGISHandler(z3::context   * const   ctx,
-                           z3::expr_vector const & implVars,
-                           z3::expr_vector const & inpVars,
-                           z3::expr_vector const & hlpVars,
-                           z3::expr        const & implExpr,
-                           z3::expr        const & behavExpr,
-                           z3::expr        const & corrExpr)
-        :
-        context{ctx},
-        implementationVariables{implVars},
-        inputVariables{inpVars},
-        helperVariables{hlpVars},
-        implementationExpression{implExpr},
-        behavioralExpression{behavExpr},
-        correctnessExpression{corrExpr},
-        implementationSolver{*context},
-        counterExampleSolver{*context},
-        counterExamples{}
-{}
+    std::stringstream hex;
+    hex << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return hex.str();
+}
 
-const CEGISHandler::CEGISResult CEGISHandler::CEGISRoutine()
+bool CEGISHandler::saveCounterExamples(const std::string & file) const
 {
-    implementationSolver.add(implementationExpression);
-    counterExampleSolver.add(behavioralExpression && !correctnessExpression);
+    std::ofstream out{file};
+    if (!out)
+        return false;
 
-    auto start = clock::now();
-    while (true) {
-        auto implTp = findImplementation();
-        if (getResult(implTp) == z3::sat) // another implementation was found
+    out << STORE_MAGIC << '\t' << specificationHash() << '\t' << inputVariables.size() << '\n';
+    for (auto i = 0u; i < inputVariables.size(); ++i)
+        out << inputVariables[i].decl().name().str() << '\t' << inputVariables[i].get_sort() << '\n';
+
+    for (const auto & ce : counterExamples)
+    {
+        for (auto i = 0u; i < inputVariables.size(); ++i)
+            out << (i ? "\t" : "") << encodeValue(ce.getValue(i));
+        out << '\n';
+    }
+
+    return static_cast<bool>(out);
+}
+
+size_t CEGISHandler::loadCounterExamples(const std::string & file, bool sameSpecification, size_t * skipped)
+{
+    if (skipped)
+        *skipped = 0;
+
+    std::ifstream in{file};
+    std::string line, field;
+    if (!in || !std::getline(in, line))
+        return 0;
+
+    // header: magic, specification hash and number of stored inputs
+    std::stringstream header{line};
+    std::string magic, hash;
+    size_t stored = 0;
+    if (!std::getline(header, magic, '\t') || magic != STORE_MAGIC || !std::getline(header, hash, '\t') ||
+        !(header >> stored))
+        return 0;
+    if (sameSpecification && hash != specificationHash())
+        return 0;
+
+    // map the stored columns to the handler's input variables by name and sort
+    std::unordered_map<std::string, size_t> inputs;
+    for (auto i = 0u; i < inputVariables.size(); ++i)
+    {
+        std::stringstream key;
+        key << inputVariables[i].decl().name().str() << '\t' << inputVariables[i].get_sort();
+        inputs.emplace(key.str(), i);
+    }
+    std::vector<int> columns;
+    for (auto c = 0u; c < stored; ++c)
+    {
+        if (!std::getline(in, line))
+            return 0;
+        auto it = inputs.find(line);
+        columns.push_back(it == inputs.end() ? -1 : static_cast<int>(it->second));
+        if (it != inputs.end())
+            inputs.erase(it);
+    }
+    if (!inputs.empty())
+        return 0;
+
+    // stream the counter examples
+    size_t loaded = 0;
+    while (std::getline(in, line))
+    {
+        if (line.empty())
+            continue;
+
+        // a file truncated by an interrupted run ends within a line, i.e. without its newline
+        bool complete = !in.eof() && static_cast<size_t>(std::count(line.begin(), line.end(), '\t')) + 1 == stored;
+        z3::model m{*context};
+        std::stringstream values{line};
+        for (auto c = 0u; complete && c < stored && std::getline(values, field, '\t'); ++c)
         {
-            auto ceTp = findCounterExample(getImpl(implTp));
-            if (getResult(ceTp) == z3::sat) // another counter-example was found
+            if (columns[c] < 0)
+                continue;
+
+            z3::expr var = inputVariables[columns[c]];
+            z3::func_decl decl = var.decl();
+            try
             {
-                counterExamples.push_back(std::move(getCE(ceTp)));
-            } else // no more counter-examples possible
+                z3::expr value = decodeValue(*context, var, field);
+                m.add_const_interp(decl, value);
+            }
+            catch (const z3::exception &)
             {
-                return CEGISResult(implTp, counterExamples, start, clock::now(), name);
+                complete = false;
             }
-        } else // no implementation possible
+        }
+
+        if (!complete)
         {
-            return CEGISResult(implTp, counterExamples, start, clock::now(), name);
+            if (skipped)
+                ++*skipped;
+            continue;
         }
+        recordCounterExamples({CounterExample(*store, store->add(m))});
+        ++loaded;
     }
+
+    return loaded;
 }
 
-const CEGISHandler::ImplementationPair CEGISHandler::findImplementation()
+void CEGISHandler::setPruning(size_t interval, size_t threshold)
 {
-    if (!counterExamples.empty()) {
-        // extract constraints from latest counter example
-        auto counterExampleCons = counterExamples.back()
-                .extractConstraints(inputVariables, INPUT_VAR_TEMPLATE, context);
+    pruneInterval = interval;
+    rebuildThreshold = threshold;
+}
 
-        // substitute variables in behavior and correctness expression
-        auto subExpr = substituteVars(behavioralExpression && correctnessExpression,
-                                      inputVariables, INPUT_VAR_TEMPLATE);
-        subExpr = substituteVars(subExpr, helperVariables, HELPER_VAR_TEMPLATE);
+void CEGISHandler::setSymmetryGroups(const std::vector<z3::expr_vector> & groups, size_t limit)
+{
+    std::unordered_map<unsigned, size_t> positions;
+    for (auto i = 0u; i < inputVariables.size(); ++i)
+        positions.emplace(inputVariables[i].id(), i);
 
-        implementationSolver.add(counterExampleCons && subExpr);
-    }
-    switch (implementationSolver.check())
+    std::vector<std::vector<size_t>> resolved;
+    std::unordered_set<size_t> used;
+    for (const auto & group : groups)
     {
-        case z3::sat:
+        std::vector<size_t> positionsOfGroup;
+        for (auto i = 0u; i < group.size(); ++i)
         {
-            auto m = implementationSolver.get_model();
-            return std::make_pair(Implementation(m), z3::sat);
+            auto it = positions.find(group[i].id());
+            if (it == positions.end() || !used.insert(it->second).second)
+                throw z3::exception("symmetry groups have to consist of distinct input variables");
+            if ((!group[i].is_bool() && !group[i].is_bv()) || !z3::eq(group[i].get_sort(), group[0].get_sort()))
+                throw z3::exception("the inputs of a symmetry group have to share a Boolean or bit-vector sort");
+            positionsOfGroup.push_back(it->second);
         }
-        case z3::unsat:
-            return std::make_pair(boost::optional<Implementation>(), z3::unsat);
-        case z3::unknown:
-            return std::make_pair(boost::optional<Implementation>(), z3::unknown);
+        if (positionsOfGroup.size() > 1)
+            resolved.push_back(positionsOfGroup);
     }
+
+    symmetryGroups = resolved;
+    orbitLimit = limit;
 }
 
-const CEGISHandler::CounterExamplePair CEGISHandler::findCounterExample(const Implementation & impl)
+void CEGISHandler::setCoreGeneralization(bool enable) { coreGeneralization = enable; }
+
+void CEGISHandler::setPreprocessing(bool enable) { preprocessing = enable; }
+
+void CEGISHandler::setSimulation(size_t lanes, size_t rounds)
 {
-    auto implCons = impl.extractConstraints(implementationVariables, context);
-    counterExampleSolver.push();
-    counterExampleSolver.add(implCons);
-    switch (counterExampleSolver.check())
+    simulationLanes = lanes;
+    simulationRounds = std::max(rounds, size_t{1});
+}
+
+void CEGISHandler::setTruthTableThreshold(size_t n) { truthTableThreshold = n; }
+
+void CEGISHandler::setName(std::string n) { name = n; }
+
+void CEGISHandler::setStatistics(bool enable) { collectStatistics = enable; }
+
+void CEGISHandler::setTimeout(unsigned ms) { timeout = ms; }
+
+void CEGISHandler::setMaxCounterExamples(size_t n) { maxCounterExamples = n; }
+
+void CEGISHandler::setMemoryLimit(size_t megabytes) { memoryLimit = megabytes; }
+
+void CEGISHandler::cancel()
+{
+    std::lock_guard<std::mutex> lock{runMutex};
+    cancelled = true;
+    if (running)
+        interruptSolvers();
+}
+
+void CEGISHandler::setImplementationPortfolio(size_t workers, const std::vector<std::string> & tactics)
+{
+    if (workers < 2)
+        implementationPortfolio.reset();
+    else
+        implementationPortfolio.reset(new SolverPortfolio(workers, tactics));
+}
+
+void CEGISHandler::setPipelining(bool enable) { pipelining = enable; }
+
+void CEGISHandler::setCubeSharding(unsigned depth) { cubeDepth = depth; }
+
+void CEGISHandler::setBatchSize(size_t k) { batchSize = std::max(k, size_t{1}); }
+
+void CEGISHandler::setSolverConfiguration(SolverRole role, const SolverConfiguration & config)
+{
+    profile[role] = config;
+    // a live solver holds the base level and all instances, hence it is rebuilt by the next run as a whole
+    if (initialized)
+        solversInterrupted = true;
+    else if (role == SolverRole::IMPLEMENTATION)
+        implementationSolver = config.makeSolver(*context);
+    else
+        counterExampleSolver = config.makeSolver(*context);
+}
+
+void CEGISHandler::setSolverProfile(const SolverProfile & p)
+{
+    setSolverConfiguration(SolverRole::IMPLEMENTATION, p.implementation);
+    setSolverConfiguration(SolverRole::COUNTER_EXAMPLE, p.counterExample);
+}
+
+void CEGISHandler::setCounterExamplePortfolio(size_t workers, const std::vector<std::string> & tactics)
+{
+    if (workers < 2)
+        counterExamplePortfolio.reset();
+    else
+        counterExamplePortfolio.reset(new SolverPortfolio(workers, tactics));
+}
+
+void CEGISHandler::setVerificationProcesses(size_t workers, const std::string & executable, size_t megabytes)
+{
+    if (!workers)
+        counterExampleProcesses.reset();
+    else
+        counterExampleProcesses.reset(new ProcessPortfolio(workers, executable, megabytes));
+}
+
+
+// ************************************************************
+// ******************* AsyncVerifier **************************
+// ************************************************************
+
+CEGISHandler::AsyncVerifier::AsyncVerifier(const z3::expr_vector     & implVars,
+                                           const z3::expr_vector     & inpVars,
+                                           const z3::expr            & property,
+                                           const SolverConfiguration & config)
+        :
+        context{},
+        solver{config.makeSolver(context)},
+        configuration{config},
+        specification{context, Z3_translate(property.ctx(), property, context)},
+        implementationVariables{context},
+        inputVariables{context},
+        models{},
+        job{},
+        runtime{0}
+{
+    for (auto i = 0u; i < implVars.size(); ++i)
+        implementationVariables.push_back(z3::expr(context, Z3_translate(implVars.ctx(), implVars[i], context)));
+    for (auto i = 0u; i < inpVars.size(); ++i)
+        inputVariables.push_back(z3::expr(context, Z3_translate(inpVars.ctx(), inpVars[i], context)));
+    solver.add(specification);
+}
+
+void CEGISHandler::AsyncVerifier::start(const std::vector<z3::expr> & valuation, size_t batch, unsigned ms)
+{
+    // translate on the calling thread, the verification thread may only touch the private context
+    std::vector<z3::expr> values;
+    for (const auto & v : valuation)
+        values.emplace_back(context, Z3_translate(v.ctx(), v, context));
+
+    job = std::async(std::launch::async, [this, values, batch, ms]
     {
-        case z3::sat:
+        auto jobStart = clock::now();
+        z3::params p{context};
+        p.set("timeout", ms);
+        solver.set(p);
+        models.clear();
+
+        auto result = z3::unknown;
+        bool canceled = false;
+        solver.push();
+        try
+        {
+            for (auto i = 0u; i < implementationVariables.size(); ++i)
+                solver.add(implementationVariables[i] == values[i]);
+
+            result = solver.check();
+            if (result == z3::sat)
+            {
+                // further distinct counter examples for the same implementation
+                models.push_back(solver.get_model());
+                while (models.size() < batch)
+                {
+                    z3::expr_vector differ{context};
+                    for (auto i = 0u; i < inputVariables.size(); ++i)
+                        differ.push_back(inputVariables[i] != models.back().eval(inputVariables[i], true));
+                    solver.add(z3::mk_or(differ));
+
+                    auto next = solver.check();
+                    canceled = next == z3::unknown;
+                    if (next != z3::sat)
+                        break;
+                    models.push_back(solver.get_model());
+                }
+            }
+            canceled |= result == z3::unknown;
+        }
+        catch (const z3::exception &)
         {
-            auto m = counterExampleSolver.get_model();
-            counterExampleSolver.pop();
-            return std::make_pair(CounterExample(m), z3::sat);
+            canceled = true;
+            if (models.empty())
+                result = z3::unknown;
         }
-        case z3::unsat:
-            return std::make_pair(boost::optional<CounterExample>(), z3::unsat);
-        case z3::unknown:
-            return std::make_pair(boost::optional<CounterExample>(), z3::unknown);
-    }
+
+        // a canceled solver is not trusted anymore, not even to pop, hence it is replaced by a fresh one; running an
+        // empty solver resets the canceled state beforehand
+        if (canceled)
+        {
+            z3::solver{context, z3::solver::simple()}.check();
+            solver = configuration.makeSolver(context);
+            solver.add(specification);
+        }
+        else
+            solver.pop();
+
+        runtime = elapsed(jobStart);
+        return result;
+    });
 }
 
-const z3::expr CEGISHandler::substituteVars(const z3::expr        & expr,
-                                            const z3::expr_vector & vars,
-                                                  boost::format     templ) const
+bool CEGISHandler::AsyncVerifier::isRunning() const { return job.valid(); }
+
+z3::check_result CEGISHandler::AsyncVerifier::wait(z3::context & ctx, std::vector<z3::model> & found)
 {
-    z3::expr_vector sub_vars{*context};
-    for (auto i = 0; i < vars.size(); ++i)
+    auto result = job.get();
+    if (result == z3::sat)
     {
-        z3::expr current = vars[i];
-        const char *name = (templ % i % ceID).str().c_str();
-        z3::expr e = context->constant(name, current.get_sort());
-        sub_vars.push_back(e);
+        for (auto & m : models)
+            found.emplace_back(m, ctx, z3::model::translate());
     }
-    return z3::expr(expr).substitute(vars, sub_vars);
+    return result;
 }
 
-void CEGISHandler::setName(std::string n) { name = n; }
+long CEGISHandler::AsyncVerifier::getRuntime() const { return runtime; }
+
+void CEGISHandler::AsyncVerifier::interrupt() { context.interrupt(); }
+
+void CEGISHandler::AsyncVerifier::clearInterrupts() { z3::solver{context, z3::solver::simple()}.check(); }
 
 
 // ************************************************************
@@ -136,82 +1783,365 @@ const z3::expr CEGISHandler::Implementation::extractConstraints(const z3::expr_v
     z3::expr_vector val{*ctx};
     for (auto i = 0; i < implVars.size(); ++i) {
         z3::expr var = implVars[i];
-        val.push_back(var == model.eval(var));
+        val.push_back(var == model.eval(var, true));
     }
     return z3::mk_and(val);
 }
 
-const z3::expr CEGISHandler::Implementation::getValuation(z3::expr var) const { return model.eval(var); }
+const z3::expr_vector CEGISHandler::Implementation::extractBitConstraints(const z3::expr_vector & implVars,
+                                                                            z3::context     * ctx) const
+{
+    z3::expr_vector val{*ctx};
+    for (auto i = 0u; i < implVars.size(); ++i) {
+        z3::expr var = implVars[i];
+        z3::expr value = model.eval(var, true);
+        if (var.is_bv())
+        {
+            for (auto b = 0u; b < var.get_sort().bv_size(); ++b)
+                val.push_back(var.extract(b, b) == value.extract(b, b).simplify());
+        }
+        else
+            val.push_back(var == value);
+    }
+    return val;
+}
+
+const z3::expr CEGISHandler::Implementation::getValuation(z3::expr var, bool completion) const
+{
+    return model.eval(var, completion);
+}
 
 
 // ************************************************************
-// ******************* CounterExample *************************
+// ***************** CounterExampleStore **********************
 // ************************************************************
 
-CEGISHandler::CounterExample::CounterExample(const z3::model & mdl)
+CEGISHandler::CounterExampleStore::CounterExampleStore(const z3::expr_vector & inputVars)
         :
-        model(mdl),
-        id(ceID++)
-{}
+        inputs{inputVars},
+        offsets{},
+        words{},
+        numerals{inputVars.ctx()}
+{
+    for (auto i = 0u; i < inputs.size(); ++i)
+    {
+        offsets.push_back(stride);
+        auto sort = inputs[i].get_sort();
+        // bit-vectors occupy as many words as needed, everything else one word
+        stride += sort.is_bv() ? (sort.bv_size() + 63) / 64 : 1;
+    }
+}
+
+size_t CEGISHandler::CounterExampleStore::add(const z3::model & mdl)
+{
+    auto base = words.size();
+    words.resize(base + stride);
+    for (auto i = 0u; i < inputs.size(); ++i)
+    {
+        z3::expr var = inputs[i];
+        auto value = mdl.eval(var, true);
+        auto word = &words[base + offsets[i]];
+
+        if (var.is_bool())
+            *word = value.is_true();
+        else if (var.is_bv() && var.get_sort().bv_size() <= 64)
+            *word = value.get_numeral_uint64();
+        else if (var.is_bv())
+        {
+            auto width = var.get_sort().bv_size();
+            for (auto low = 0u; low < width; low += 64)
+                *word++ = value.extract(std::min(low + 63, width - 1), low).simplify().get_numeral_uint64();
+        }
+        else
+        {
+            *word = numerals.size();
+            numerals.push_back(value);
+        }
+    }
+
+    return size() - 1;
+}
+
+size_t CEGISHandler::CounterExampleStore::add(const CounterExampleStore & from, size_t ce,
+                                               const std::vector<size_t> & sources)
+{
+    // indices instead of iterators, from may be this store
+    auto base = words.size();
+    words.resize(base + stride);
+    for (auto i = 0u; i < inputs.size(); ++i)
+    {
+        auto source = sources.empty() ? i : sources[i];
+        auto width = (i + 1 < offsets.size() ? offsets[i + 1] : stride) - offsets[i];
+        for (auto w = 0u; w < width; ++w)
+            words[base + offsets[i] + w] = from.words[ce * stride + offsets[source] + w];
+
+        z3::expr var = inputs[i];
+        if (!var.is_bool() && !var.is_bv() && &from != this)
+        {
+            auto & word = words[base + offsets[i]];
+            numerals.push_back(from.numerals[word]);
+            word = numerals.size() - 1;
+        }
+    }
+
+    return size() - 1;
+}
 
-CEGISHandler::CounterExample::CounterExample(CounterExample && ce)
+bool CEGISHandler::CounterExampleStore::less(size_t ce, size_t a, size_t b) const
+{
+    // most significant words first
+    auto width = (a + 1 < offsets.size() ? offsets[a + 1] : stride) - offsets[a];
+    for (auto w = width; w-- > 0;)
+    {
+        auto x = words[ce * stride + offsets[a] + w], y = words[ce * stride + offsets[b] + w];
+        if (x != y)
+            return x < y;
+    }
+    return false;
+}
+
+std::string CEGISHandler::CounterExampleStore::key(size_t ce, const std::vector<size_t> & sources) const
+{
+    std::vector<uint64_t> k;
+    k.reserve(stride);
+    for (auto i = 0u; i < inputs.size(); ++i)
+    {
+        auto source = sources.empty() ? i : sources[i];
+        auto width = (source + 1 < offsets.size() ? offsets[source + 1] : stride) - offsets[source];
+        z3::expr var = inputs[i];
+        for (auto w = 0u; w < width; ++w)
+        {
+            auto word = words[ce * stride + offsets[source] + w];
+            // numerals are hash-consed, hence equal values share their id
+            k.push_back(var.is_bool() || var.is_bv() ? word : numerals[word].id());
+        }
+    }
+    return {reinterpret_cast<const char *>(k.data()), k.size() * sizeof(uint64_t)};
+}
+
+const z3::expr CEGISHandler::CounterExampleStore::getValue(size_t ce, size_t input) const
+{
+    auto & ctx = inputs.ctx();
+    z3::expr var = inputs[input];
+    auto word = &words[ce * stride + offsets[input]];
+
+    if (var.is_bool())
+        return ctx.bool_val(*word != 0);
+    if (!var.is_bv())
+        return numerals[*word];
+
+    auto width = var.get_sort().bv_size();
+    if (width <= 64)
+        return ctx.bv_val(*word, width);
+
+    // assemble wide values from their words, most significant first
+    auto chunks = (width + 63) / 64;
+    auto value = ctx.bv_val(word[chunks - 1], width - 64 * (chunks - 1));
+    for (auto c = chunks - 1; c-- > 0;)
+        value = z3::concat(value, ctx.bv_val(word[c], 64));
+    return value.simplify();
+}
+
+void CEGISHandler::CounterExampleStore::truncate(size_t n)
+{
+    if (n < size())
+        words.resize(n * stride);
+}
+
+size_t CEGISHandler::CounterExampleStore::size() const { return stride ? words.size() / stride : words.size(); }
+
+
+// ************************************************************
+// ******************* CounterExample *************************
+// ************************************************************
+
+CEGISHandler::CounterExample::CounterExample(const CounterExampleStore & s, size_t n)
         :
-        model(std::move(ce.model)),
-        id(std::move(ce.id))
+        store(&s),
+        id(n)
 {}
 
-const z3::expr CEGISHandler::CounterExample::extractConstraints(const z3::expr_vector & inputVars,
-                                                                      boost::format     templ,
+const z3::expr CEGISHandler::CounterExample::extractConstraints(const z3::expr_vector & renamedVars,
+                                                                      size_t            inputs,
                                                                       z3::context     * ctx) const
 {
     z3::expr_vector val{*ctx};
-    for (auto i = 0; i < inputVars.size(); ++i)
-    {
-        z3::expr var = inputVars[i];
-        const char *name = (templ % i % id).str().c_str();
-        val.push_back(ctx->constant(name, var.get_sort()) == model.eval(var));
-    }
+    for (auto i = 0u; i < inputs; ++i)
+        val.push_back(renamedVars[i] == store->getValue(id, i));
     return z3::mk_and(val);
 }
 
+const z3::expr CEGISHandler::CounterExample::extractBlockingConstraint(const z3::expr_vector & inputVars,
+                                                                             z3::context     * ctx) const
+{
+    z3::expr_vector val{*ctx};
+    for (auto i = 0u; i < inputVars.size(); ++i)
+        val.push_back(inputVars[i] != store->getValue(id, i));
+    return z3::mk_or(val);
+}
+
+const z3::expr CEGISHandler::CounterExample::getValue(size_t input) const { return store->getValue(id, input); }
+
 const size_t CEGISHandler::CounterExample::getNumber() const { return id; }
 
 
 
+// ************************************************************
+// ******************* SolverStatistics ***********************
+// ************************************************************
+
+CEGISHandler::SolverStatistics CEGISHandler::SolverStatistics::from(const z3::stats & st)
+{
+    SolverStatistics s{};
+    for (auto i = 0u; i < st.size(); ++i)
+    {
+        const auto key = st.key(i);
+        const double value = st.is_uint(i) ? st.uint_value(i) : st.double_value(i);
+        // the SMT core and the SAT solver report their counters under different keys
+        if (key == "conflicts" || key == "sat conflicts")
+            s.conflicts += static_cast<unsigned long>(value);
+        else if (key == "decisions" || key == "sat decisions")
+            s.decisions += static_cast<unsigned long>(value);
+        else if (key == "memory")
+            s.memory = value;
+    }
+    return s;
+}
+
+
+// ************************************************************
+// ******************* VariableRenamer ************************
+// ************************************************************
+
+CEGISHandler::VariableRenamer::VariableRenamer(z3::context * const ctx,
+                                               const z3::expr_vector & inputVars,
+                                               const z3::expr_vector & helperVars,
+                                               const z3::expr        & expr)
+        :
+        context{ctx},
+        variables{*ctx},
+        sorts{},
+        prefixes{},
+        inputs{inputVars.size()},
+        skeleton{expr},
+        symbols{}
+{
+    for (auto i = 0u; i < inputVars.size(); ++i)
+    {
+        variables.push_back(inputVars[i]);
+        sorts.push_back(inputVars[i].get_sort());
+        prefixes.push_back("inp_" + std::to_string(i) + "_");
+    }
+    for (auto i = 0u; i < helperVars.size(); ++i)
+    {
+        variables.push_back(helperVars[i]);
+        sorts.push_back(helperVars[i].get_sort());
+        prefixes.push_back("hlp_" + std::to_string(i) + "_");
+    }
+}
+
+const z3::expr_vector & CEGISHandler::VariableRenamer::getSymbols(size_t id)
+{
+    auto it = symbols.find(id);
+    if (it != symbols.end())
+        return it->second;
+
+    const std::string suffix = std::to_string(id);
+    std::string name;
+    z3::expr_vector syms{*context};
+    for (auto i = 0u; i < prefixes.size(); ++i)
+    {
+        name.assign(prefixes[i]).append(suffix);
+        syms.push_back(context->constant(name.c_str(), sorts[i]));
+    }
+
+    return symbols.emplace(id, syms).first->second;
+}
+
+const z3::expr CEGISHandler::VariableRenamer::instantiate(size_t id)
+{
+    return z3::expr(skeleton).substitute(variables, getSymbols(id));
+}
+
+size_t CEGISHandler::VariableRenamer::getNumberOfVariables() const { return variables.size(); }
+
+void CEGISHandler::VariableRenamer::setSkeleton(const z3::expr_vector & helperVars, const z3::expr & expr)
+{
+    z3::expr_vector inputVars{*context};
+    for (auto i = 0u; i < inputs; ++i)
+        inputVars.push_back(variables[i]);
+
+    variables = inputVars;
+    sorts.erase(sorts.begin() + inputs, sorts.end());
+    prefixes.erase(prefixes.begin() + inputs, prefixes.end());
+    for (auto i = 0u; i < helperVars.size(); ++i)
+    {
+        variables.push_back(helperVars[i]);
+        sorts.push_back(helperVars[i].get_sort());
+        prefixes.push_back("hlp_" + std::to_string(i) + "_");
+    }
+
+    skeleton = expr;
+    symbols.clear();
+}
+
+
 // ************************************************************
 // ********************* CEGISResult **************************
 // ************************************************************
 
-CEGISHandler::CEGISResult::CEGISResult(const ImplementationPair          & implP,
-                                       const std::vector<CounterExample> & ces,
-                                       const CEGISResult::TimePoint      & start,
-                                       const CEGISResult::TimePoint      & end,
-                                       const std::string                 & n)
+CEGISHandler::CEGISResult::CEGISResult(const ImplementationPair           & implP,
+                                       const std::shared_ptr<const CounterExampleStore> & ces,
+                                       size_t                               count,
+                                       const CEGISResult::TimePoint       & start,
+                                       const CEGISResult::TimePoint       & end,
+                                       const std::string                  & n,
+                                       const std::vector<IterationRecord> & its,
+                                       const StopReason                   & r)
         :
         implementation(getOImpl(implP)),
         result(getResult(implP)),
         counterExamples(ces),
+        numberOfCounterExamples(count),
         startPoint(start),
         endPoint(end),
-        name(n)
+        name(n),
+        iterations(its),
+        reason(r)
 {}
 
+CEGISHandler::CEGISResult CEGISHandler::CEGISResult::failure(z3::context & ctx, const TimePoint & start,
+                                                             const std::string & n)
+{
+    return CEGISResult(std::make_pair(boost::none, z3::unknown),
+                       std::make_shared<CounterExampleStore>(z3::expr_vector{ctx}), 0, start,
+                       std::chrono::high_resolution_clock::now(), n, {}, StopReason::ERROR);
+}
+
 const z3::check_result CEGISHandler::CEGISResult::check() const { return result; }
 
-const z3::expr CEGISHandler::CEGISResult::getValuation(const z3::expr var) const
+const z3::expr CEGISHandler::CEGISResult::getValuation(const z3::expr var, bool completion) const
 {
     assert(check() == z3::sat);
-    return implementation.get().getValuation(var);
+    return implementation.get().getValuation(var, completion);
 }
 
-const size_t CEGISHandler::CEGISResult::getNumberOfCounterExamples() const { return counterExamples.size(); }
+CEGISHandler::StopReason CEGISHandler::CEGISResult::getStopReason() const { return reason; }
+
+const size_t CEGISHandler::CEGISResult::getNumberOfCounterExamples() const { return numberOfCounterExamples; }
+
+const z3::expr CEGISHandler::CEGISResult::getCounterExampleValue(size_t ce, size_t input) const
+{
+    assert(ce < numberOfCounterExamples);
+    return counterExamples->getValue(ce, input);
+}
 
 long CEGISHandler::CEGISResult::getRuntime() const
 {
     return std::chrono::duration_cast<std::chrono::milliseconds>( endPoint - startPoint ).count();
 }
 
-void CEGISHandler::CEGISResult::print(std::ostream &out, bool csv)
+void CEGISHandler::CEGISResult::print(std::ostream &out, bool csv) const
 {
     if (csv)
         out << name << ", " << result << ", " << getNumberOfCounterExamples() << ", " << getRuntime() << std::endl;
@@ -221,5 +2151,58 @@ void CEGISHandler::CEGISResult::print(std::ostream &out, bool csv)
         out << "Result:            " << result                          << std::endl;
         out << "#Counter-examples: " << getNumberOfCounterExamples()    << std::endl;
         out << "Runtime:           " << getRuntime() << " milliseconds" << std::endl;
+        if (reason != StopReason::SOLVED && reason != StopReason::UNREALIZABLE && reason != StopReason::UNKNOWN)
+            out << "Stopped early:     " << stopReasonName(reason)    << std::endl;
+    }
+}
+
+const std::vector<CEGISHandler::IterationRecord> & CEGISHandler::CEGISResult::getIterations() const
+{
+    return iterations;
+}
+
+void CEGISHandler::CEGISResult::printIterations(std::ostream &out, bool json) const
+{
+    if (json)
+    {
+        out << "[";
+        for (auto i = 0u; i < iterations.size(); ++i)
+        {
+            const auto & it = iterations[i];
+            out << (i ? ",\n " : "\n ")
+                << "{\"benchmark\": \"" << escapeJson(name) << "\", \"iteration\": " << i
+                << ", \"implementation\": "    << it.implementationTime
+                << ", \"counter-example\": "   << it.counterExampleTime
+                << ", \"extraction\": "        << it.extractionTime
+                << ", \"substitution\": "      << it.substitutionTime
+                << ", \"counter-examples\": "  << it.counterExamples
+                << ", \"assertions\": "        << it.assertions
+                << ", \"impl-conflicts\": "    << it.implementationStatistics.conflicts
+                << ", \"impl-decisions\": "    << it.implementationStatistics.decisions
+                << ", \"impl-memory\": "       << it.implementationStatistics.memory
+                << ", \"ce-conflicts\": "      << it.counterExampleStatistics.conflicts
+                << ", \"ce-decisions\": "      << it.counterExampleStatistics.decisions
+                << ", \"ce-memory\": "         << it.counterExampleStatistics.memory
+                << ", \"retired\": "           << it.retired
+                << ", \"generalizations\": "   << it.generalizations
+                << ", \"verifier\": \""        << verifierName(it.verifier) << "\""
+                << ", \"cubes\": "             << it.cubes
+                << ", \"relabeled\": "         << it.relabeled << "}";
+        }
+        out << "\n]" << std::endl;
+    }
+    else
+    {
+        for (auto i = 0u; i < iterations.size(); ++i)
+        {
+            const auto & it = iterations[i];
+            out << name << ", " << i << ", " << it.implementationTime << ", " << it.counterExampleTime << ", "
+                << it.extractionTime << ", " << it.substitutionTime << ", " << it.counterExamples << ", "
+                << it.assertions << ", " << it.implementationStatistics.conflicts << ", "
+                << it.implementationStatistics.decisions << ", " << it.implementationStatistics.memory << ", "
+                << it.counterExampleStatistics.conflicts << ", " << it.counterExampleStatistics.decisions << ", "
+                << it.counterExampleStatistics.memory << ", " << it.retired << ", " << it.generalizations << ", "
+                << verifierName(it.verifier) << ", " << it.cubes << ", " << it.relabeled << std::endl;
+        }
     }
 }
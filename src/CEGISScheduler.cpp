@@ -0,0 +1,147 @@
+//
+// Created by marcel on 16.10.26.
+//
+
+#include "CEGISScheduler.h"
+
+CEGISScheduler::CEGISScheduler(size_t size)
+        :
+        workers{}
+{
+    for (auto i = 0u; i < std::max(size, size_t{1}); ++i)
+        workers.emplace_back(new Worker());
+}
+
+void CEGISScheduler::submit(const Task & task)
+{
+    size_t index;
+    {
+        std::lock_guard<std::mutex> lock{poolMutex};
+        index = next;
+        next = (next + 1) % workers.size();
+        ++pending;
+    }
+    {
+        std::lock_guard<std::mutex> lock{workers[index]->mutex};
+        workers[index]->tasks.push_back(task);
+    }
+    poolCv.notify_all();
+}
+
+bool CEGISScheduler::take(size_t index, Task & task)
+{
+    {
+        auto & own = *workers[index];
+        std::lock_guard<std::mutex> lock{own.mutex};
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+
+    // steal from the back of the other queues
+    for (auto i = 1u; i < workers.size(); ++i)
+    {
+        auto & victim = *workers[(index + i) % workers.size()];
+        std::lock_guard<std::mutex> lock{victim.mutex};
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void CEGISScheduler::work(size_t index, const ResultCallback & callback)
+{
+    auto & worker = *workers[index];
+    while (true)
+    {
+        Task task;
+        if (!take(index, task))
+        {
+            // wait for tasks submitted by running ones or for the last task to complete
+            std::unique_lock<std::mutex> lock{poolMutex};
+            if (pending == 0 || cancelled)
+                return;
+            poolCv.wait_for(lock, std::chrono::milliseconds(10));
+            continue;
+        }
+
+        if (!cancelled)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            boost::optional<CEGISHandler::CEGISResult> result{};
+            std::unique_ptr<CEGISHandler> handler{};
+            try
+            {
+                handler = task(worker.context);
+                {
+                    std::lock_guard<std::mutex> lock{handlerMutex};
+                    worker.handler = handler.get();
+                }
+                if (cancelled)
+                    handler->cancel();
+
+                result.emplace(handler->CEGISRoutine());
+            }
+            catch (...)
+            {
+                // a failing task must neither take down the pool nor go unreported
+                result.emplace(CEGISHandler::CEGISResult::failure(worker.context, start));
+            }
+            {
+                std::lock_guard<std::mutex> lock{handlerMutex};
+                worker.handler = nullptr;
+            }
+            {
+                std::lock_guard<std::mutex> lock{callbackMutex};
+                callback(*result);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{poolMutex};
+            --pending;
+        }
+        poolCv.notify_all();
+    }
+}
+
+void CEGISScheduler::run(const ResultCallback & callback)
+{
+    cancelled = false;
+
+    std::vector<std::thread> threads;
+    for (auto i = 0u; i < workers.size(); ++i)
+        threads.emplace_back(&CEGISScheduler::work, this, i, std::cref(callback));
+
+    for (auto & t : threads)
+        t.join();
+
+    // discard tasks left over by a cancellation
+    for (auto & w : workers)
+        w->tasks.clear();
+    pending = 0;
+}
+
+void CEGISScheduler::cancel()
+{
+    cancelled = true;
+    {
+        std::lock_guard<std::mutex> lock{handlerMutex};
+        for (auto & w : workers)
+        {
+            if (w->handler)
+                w->handler->cancel();
+        }
+    }
+    poolCv.notify_all();
+}
+
+size_t CEGISScheduler::size() const { return workers.size(); }
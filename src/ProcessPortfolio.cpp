@@ -0,0 +1,591 @@
+//
+// Created by marcel on 16.10.26.
+//
+
+#include "ProcessPortfolio.h"
+#include <algorithm>
+#include <thread>
+#include <unordered_set>
+#include <csignal>
+#include <cerrno>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+namespace
+{
+    /**
+     * Number of consecutive failed starts after which a worker is given up.
+     */
+    const unsigned MAX_FAILURES = 3;
+
+    /**
+     * Additional address space granted to a worker on top of its Z3 memory limit, e.g. for code and stacks.
+     */
+    const size_t ADDRESS_SPACE_SLACK = 512;
+
+    /**
+     * Collects the uninterpreted constants occurring in the given expression.
+     */
+    void collectConstants(const z3::expr & e, std::unordered_map<std::string, z3::func_decl> & constants)
+    {
+        std::unordered_set<unsigned> visited;
+        std::vector<z3::expr> stack{e};
+        while (!stack.empty())
+        {
+            auto top = stack.back();
+            stack.pop_back();
+            if (!visited.insert(top.id()).second)
+                continue;
+
+            if (top.is_quantifier())
+                stack.push_back(top.body());
+            else if (top.is_app())
+            {
+                if (top.num_args() == 0 && top.decl().decl_kind() == Z3_OP_UNINTERPRETED)
+                    constants.emplace(top.decl().name().str(), top.decl());
+                for (auto i = 0u; i < top.num_args(); ++i)
+                    stack.push_back(top.arg(i));
+            }
+        }
+    }
+
+    /**
+     * Reads a value printed by a worker for a constant of the given declaration.
+     */
+    z3::expr parseValue(z3::context & ctx, const z3::func_decl & decl, const std::string & value)
+    {
+        if (decl.range().is_bool())
+            return ctx.bool_val(value == "true");
+
+        const std::string smt = "(declare-fun value () " + decl.range().to_string() + ")(assert (= value " + value + "))";
+        return ctx.parse_string(smt.c_str())[0].arg(1);
+    }
+
+    /**
+     * Replaces line breaks to keep a message on a single line.
+     */
+    std::string singleLine(std::string s)
+    {
+        std::replace(s.begin(), s.end(), '\n', ' ');
+        return s;
+    }
+}
+
+
+// ************************************************************
+// ******************* ProcessPortfolio ***********************
+// ************************************************************
+
+ProcessPortfolio::ProcessPortfolio(size_t size, const std::string & exe, size_t megabytes)
+        :
+        workers(std::max(size, size_t{1})),
+        executable{exe},
+        memoryLimit{megabytes},
+        journal{},
+        timeoutCommand{},
+        constants{},
+        winner{0}
+{
+    for (auto i = 0u; i < workers.size(); ++i)
+    {
+        workers[i].seed = i;
+        start(workers[i]);
+    }
+    winner = workers.size();
+}
+
+ProcessPortfolio::~ProcessPortfolio()
+{
+    for (auto & w : workers)
+        stop(w);
+}
+
+bool ProcessPortfolio::start(Worker & w)
+{
+    if (w.failures >= MAX_FAILURES)
+        return false;
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+    {
+        ++w.failures;
+        return false;
+    }
+
+    // prepare everything before forking, the child may only use async-signal-safe functions
+    const std::string seed = std::to_string(w.seed), memory = std::to_string(memoryLimit);
+    std::vector<char *> argv{const_cast<char *>(executable.c_str()),
+                             const_cast<char *>("--seed"),   const_cast<char *>(seed.c_str()),
+                             const_cast<char *>("--memory"), const_cast<char *>(memory.c_str()), nullptr};
+    rlimit limit{};
+    limit.rlim_cur = limit.rlim_max = (memoryLimit + ADDRESS_SPACE_SLACK) * 1024 * 1024;
+
+    pid_t pid;
+    {
+        std::lock_guard<std::mutex> lock{interruptMutex};
+        pid = fork();
+        if (pid == 0)
+        {
+            dup2(fds[1], STDIN_FILENO);
+            dup2(fds[1], STDOUT_FILENO);
+            if (memoryLimit)
+                setrlimit(RLIMIT_AS, &limit);
+            execvp(argv[0], argv.data());
+            _exit(127);
+        }
+        w.pid = pid > 0 ? pid : 0;
+    }
+    close(fds[1]);
+
+    if (pid < 0)
+    {
+        close(fds[0]);
+        ++w.failures;
+        return false;
+    }
+    w.fd = fds[0];
+    w.buffer.clear();
+
+    // wait for the greeting, then bring the new process up to date
+    std::string reply;
+    bool synced = receive(w, reply) && reply == "ready";
+    if (synced && !timeoutCommand.empty())
+        synced = send(w, timeoutCommand) && receive(w, reply);
+    for (auto it = journal.cbegin(); synced && it != journal.cend(); ++it)
+        synced = send(w, *it) && receive(w, reply);
+
+    if (!synced)
+    {
+        stop(w);
+        ++w.failures;
+        return false;
+    }
+
+    w.failures = 0;
+    return true;
+}
+
+void ProcessPortfolio::stop(Worker & w)
+{
+    if (!w.pid)
+        return;
+
+    pid_t pid;
+    {
+        std::lock_guard<std::mutex> lock{interruptMutex};
+        pid = w.pid;
+        w.pid = 0;
+    }
+    close(w.fd);
+    w.fd = -1;
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+}
+
+bool ProcessPortfolio::send(Worker & w, const std::string & command)
+{
+    size_t sent = 0;
+    while (sent < command.size())
+    {
+        auto n = ::send(w.fd, command.data() + sent, command.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool ProcessPortfolio::receive(Worker & w, std::string & line)
+{
+    size_t end;
+    while ((end = w.buffer.find('\n')) == std::string::npos)
+    {
+        char chunk[4096];
+        auto n = ::recv(w.fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        w.buffer.append(chunk, static_cast<size_t>(n));
+    }
+
+    line = w.buffer.substr(0, end);
+    w.buffer.erase(0, end + 1);
+    return true;
+}
+
+void ProcessPortfolio::broadcast(const std::string & command)
+{
+    std::string reply;
+    for (auto & w : workers)
+    {
+        // (re)starting a worker replays the journal and the timeout, which already include the command
+        if (!w.pid)
+            start(w);
+        else if (!send(w, command) || !receive(w, reply))
+        {
+            stop(w);
+            ++restarts;
+            start(w);
+        }
+    }
+}
+
+void ProcessPortfolio::add(const z3::expr & e)
+{
+    collectConstants(e, constants);
+
+    const std::string smt = Z3_benchmark_to_smtlib_string(e.ctx(), "", "", "unknown", "", 0, nullptr, e);
+    journal.push_back("assert\t" + std::to_string(smt.size()) + "\n" + smt);
+    broadcast(journal.back());
+}
+
+void ProcessPortfolio::reset()
+{
+    journal.clear();
+    constants.clear();
+    for (auto & w : workers)
+    {
+        stop(w);
+        start(w);
+    }
+    winner = workers.size();
+}
+
+void ProcessPortfolio::push()
+{
+    journal.emplace_back("push\n");
+    broadcast(journal.back());
+}
+
+void ProcessPortfolio::pop()
+{
+    auto scope = std::find(journal.rbegin(), journal.rend(), "push\n");
+    journal.erase(scope == journal.rend() ? journal.begin() : std::prev(scope.base()), journal.end());
+    broadcast("pop\n");
+}
+
+z3::check_result ProcessPortfolio::check()
+{
+    winner = workers.size();
+    auto result = z3::unknown;
+
+    std::vector<size_t> pending;
+    std::vector<bool> retried(workers.size(), false);
+    for (auto i = 0u; i < workers.size(); ++i)
+    {
+        auto & w = workers[i];
+        if (!w.pid && !start(w))
+            continue;
+        if (!send(w, "check\n"))
+        {
+            stop(w);
+            ++restarts;
+            retried[i] = true;
+            if (!start(w) || !send(w, "check\n"))
+                continue;
+        }
+        pending.push_back(i);
+    }
+
+    while (!pending.empty())
+    {
+        // the losers are interrupted repeatedly as they might not have entered their check yet
+        if (winner != workers.size())
+            interrupt();
+
+        std::vector<pollfd> fds;
+        for (auto i : pending)
+            fds.push_back(pollfd{workers[i].fd, POLLIN, 0});
+        if (poll(fds.data(), fds.size(), winner != workers.size() ? 1 : -1) < 0 && errno != EINTR)
+            break;
+
+        std::vector<size_t> running;
+        for (auto j = 0u; j < pending.size(); ++j)
+        {
+            auto i = pending[j];
+            auto & w = workers[i];
+            if (!fds[j].revents && w.buffer.find('\n') == std::string::npos)
+            {
+                running.push_back(i);
+                continue;
+            }
+
+            std::string reply;
+            if (!receive(w, reply))
+            {
+                // the worker died during its check, repeat the check once on a fresh one
+                stop(w);
+                ++restarts;
+                if (!retried[i] && winner == workers.size() && start(w) && send(w, "check\n"))
+                    running.push_back(i);
+                retried[i] = true;
+                continue;
+            }
+
+            auto r = reply == "sat" ? z3::sat : reply == "unsat" ? z3::unsat : z3::unknown;
+            if (r != z3::unknown && winner == workers.size())
+            {
+                winner = i;
+                result = r;
+            }
+        }
+        pending.swap(running);
+    }
+
+    return result;
+}
+
+boost::optional<z3::model> ProcessPortfolio::getModel(z3::context & ctx)
+{
+    if (winner == workers.size())
+        return boost::none;
+
+    // a partial model would be completed to default values, i.e. to an input that likely refutes nothing
+    auto & w = workers[winner];
+    std::string header;
+    if (!send(w, "model\n") || !receive(w, header) || header.compare(0, 6, "model\t") != 0)
+    {
+        stop(w);
+        ++restarts;
+        return boost::none;
+    }
+
+    z3::model m{ctx};
+    auto count = std::stoul(header.substr(6));
+    for (auto i = 0u; i < count; ++i)
+    {
+        std::string line;
+        if (!receive(w, line))
+        {
+            stop(w);
+            ++restarts;
+            return boost::none;
+        }
+
+        auto tab = line.find('\t');
+        auto it = constants.find(line.substr(0, tab));
+        if (tab == std::string::npos || it == constants.end())
+            continue;
+
+        z3::func_decl decl = it->second;
+        z3::expr value = parseValue(ctx, decl, line.substr(tab + 1));
+        m.add_const_interp(decl, value);
+    }
+
+    return m;
+}
+
+void ProcessPortfolio::setTimeout(unsigned ms)
+{
+    timeoutCommand = "timeout\t" + std::to_string(ms) + "\n";
+    broadcast(timeoutCommand);
+}
+
+void ProcessPortfolio::interrupt()
+{
+    std::lock_guard<std::mutex> lock{interruptMutex};
+    for (auto & w : workers)
+    {
+        if (w.pid)
+            kill(w.pid, SIGINT);
+    }
+}
+
+size_t ProcessPortfolio::size() const { return workers.size(); }
+
+size_t ProcessPortfolio::getRestarts() const { return restarts; }
+
+
+// ************************************************************
+// ******************* Worker side ****************************
+// ************************************************************
+
+int ProcessPortfolio::serve(std::istream & in, std::ostream & out, unsigned seed, size_t megabytes)
+{
+    // SIGINT is only handled by a dedicated thread that interrupts running checks
+    sigset_t interrupts;
+    sigemptyset(&interrupts);
+    sigaddset(&interrupts, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &interrupts, nullptr);
+
+    if (megabytes)
+        z3::set_param("memory_max_size", static_cast<int>(megabytes));
+
+    z3::context ctx;
+    z3::solver solver{ctx};
+    unsigned timeout = 0;
+    // assertions and backtracking points, to replace a solver whose check was cut short by a fresh one
+    std::vector<z3::expr> assertions{};
+    std::vector<size_t> scopes{};
+    auto rebuild = [&]
+    {
+        solver = z3::solver{ctx};
+        z3::params p{ctx};
+        p.set("random_seed", seed);
+        if (timeout)
+            p.set("timeout", timeout);
+        solver.set(p);
+
+        auto scope = scopes.cbegin();
+        for (auto i = 0u; i <= assertions.size(); ++i)
+        {
+            for (; scope != scopes.cend() && *scope == i; ++scope)
+                solver.push();
+            if (i < assertions.size())
+                solver.add(assertions[i]);
+        }
+    };
+    rebuild();
+
+    std::mutex mutex;
+    bool checking = false, interrupted = false, finished = false;
+    std::thread signals{[&]
+    {
+        int sig;
+        while (sigwait(&interrupts, &sig) == 0)
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (finished)
+                return;
+            // interrupts outside of a check would leave the context canceled
+            if (checking)
+            {
+                ctx.interrupt();
+                interrupted = true;
+            }
+        }
+    }};
+
+    out << "ready" << std::endl;
+
+    // set iff an assertion could not be parsed, the worker must not claim sat then
+    bool broken = false;
+    int status = 0;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        auto tab = line.find('\t');
+        auto command = line.substr(0, tab);
+        auto argument = tab == std::string::npos ? std::string{} : line.substr(tab + 1);
+
+        try
+        {
+            if (command == "assert")
+            {
+                std::string smt(std::stoul(argument), '\0');
+                in.read(&smt[0], static_cast<std::streamsize>(smt.size()));
+                try
+                {
+                    auto parsed = ctx.parse_string(smt.c_str());
+                    for (auto i = 0u; i < parsed.size(); ++i)
+                    {
+                        assertions.push_back(parsed[i]);
+                        solver.add(parsed[i]);
+                    }
+                    out << "ok\n";
+                }
+                catch (const z3::exception & e)
+                {
+                    broken = true;
+                    out << "error\t" << singleLine(e.msg()) << '\n';
+                }
+            }
+            else if (command == "push")
+            {
+                scopes.push_back(assertions.size());
+                solver.push();
+                out << "ok\n";
+            }
+            else if (command == "pop")
+            {
+                assertions.erase(assertions.begin() + static_cast<long>(scopes.back()), assertions.end());
+                scopes.pop_back();
+                solver.pop();
+                out << "ok\n";
+            }
+            else if (command == "timeout")
+            {
+                timeout = static_cast<unsigned>(std::stoul(argument));
+                z3::params t{ctx};
+                t.set("timeout", timeout);
+                solver.set(t);
+                out << "ok\n";
+            }
+            else if (command == "check")
+            {
+                auto result = z3::unknown;
+                {
+                    std::lock_guard<std::mutex> lock{mutex};
+                    checking = !broken;
+                }
+                try
+                {
+                    if (!broken)
+                        result = solver.check();
+                }
+                catch (const z3::exception &) {}
+                bool wasInterrupted;
+                {
+                    std::lock_guard<std::mutex> lock{mutex};
+                    checking = false;
+                    wasInterrupted = interrupted;
+                    interrupted = false;
+                }
+                // running an empty solver resets the canceled state
+                if (wasInterrupted)
+                    z3::solver{ctx, z3::solver::simple()}.check();
+                // start over with a fresh process once the memory limit was hit, before replying as the model of
+                // a satisfiable check could not be handed out anymore; the parent repeats the check on the new one
+                if (megabytes && Z3_get_estimated_alloc_size() / (1024 * 1024) >= megabytes)
+                {
+                    status = 3;
+                    break;
+                }
+
+                // a solver whose check was interrupted or gave up is not trusted anymore
+                if (result == z3::unknown && !broken)
+                    rebuild();
+
+                out << (result == z3::sat ? "sat" : result == z3::unsat ? "unsat" : "unknown") << '\n';
+            }
+            else if (command == "model")
+            {
+                auto m = solver.get_model();
+                out << "model\t" << m.num_consts() << '\n';
+                for (auto i = 0u; i < m.num_consts(); ++i)
+                {
+                    auto decl = m.get_const_decl(i);
+                    out << decl.name().str() << '\t' << singleLine(m.get_const_interp(decl).to_string()) << '\n';
+                }
+            }
+            else
+                out << "error\tunknown command " << command << '\n';
+        }
+        catch (const z3::exception & e)
+        {
+            // e.g. out of memory, the parent replaces this process on its next request
+            out << "error\t" << singleLine(e.msg()) << '\n';
+            status = 3;
+            break;
+        }
+
+        out.flush();
+    }
+    out.flush();
+
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        finished = true;
+    }
+    pthread_kill(signals.native_handle(), SIGINT);
+    signals.join();
+
+    return status;
+}
@@ -0,0 +1,553 @@
+//
+// Created by marcel on 16.10.26.
+//
+
+#include "Simulator.h"
+#include <set>
+#include <algorithm>
+
+namespace
+{
+    /**
+     * Thrown by compile() for expressions outside of the supported fragment.
+     */
+    struct Unsupported {};
+
+    inline uint64_t mask(unsigned width)
+    {
+        return width >= 64 ? ~uint64_t{0} : (uint64_t{1} << width) - 1;
+    }
+
+    inline int64_t signExtend(uint64_t v, unsigned width)
+    {
+        return width >= 64 ? static_cast<int64_t>(v)
+                           : static_cast<int64_t>(v << (64 - width)) >> (64 - width);
+    }
+
+    unsigned widthOf(const z3::sort & s)
+    {
+        if (s.is_bool())
+            return 1;
+        if (s.is_bv() && s.bv_size() <= 64)
+            return s.bv_size();
+        throw Unsupported{};
+    }
+
+    void flatten(const z3::expr & e, std::vector<z3::expr> & conjuncts)
+    {
+        if (e.is_app() && e.decl().decl_kind() == Z3_OP_AND)
+        {
+            for (auto i = 0u; i < e.num_args(); ++i)
+                flatten(e.arg(i), conjuncts);
+        }
+        else
+            conjuncts.push_back(e);
+    }
+}
+
+Simulator::Simulator(z3::expr_vector const & implVars,
+                     z3::expr_vector const & inpVars,
+                     z3::expr_vector const & hlpVars,
+                     z3::expr        const & behavExpr,
+                     z3::expr        const & corrExpr,
+                     size_t                  n,
+                     unsigned                seed)
+        :
+        lanes{std::max(n, size_t{1})},
+        inputVariables{inpVars},
+        random{seed}
+{
+    std::unordered_set<unsigned> helpers{};
+    for (auto i = 0u; i < hlpVars.size(); ++i)
+        helpers.insert(hlpVars[i].id());
+    for (const auto * vars : {&implVars, &inpVars})
+    {
+        for (auto i = 0u; i < vars->size(); ++i)
+            variables.insert((*vars)[i].id());
+    }
+
+    // top-level equations over helpers define them, everything else has to hold
+    std::vector<z3::expr> conjuncts{};
+    flatten(behavExpr, conjuncts);
+    z3::expr_vector constraints{behavExpr.ctx()};
+    for (const auto & c : conjuncts)
+    {
+        if (c.is_app() && c.decl().decl_kind() == Z3_OP_EQ)
+        {
+            auto lhs = c.arg(0), rhs = c.arg(1);
+            if (helpers.count(lhs.id()) && !definitions.count(lhs.id()))
+            {
+                definitions.emplace(lhs.id(), rhs);
+                continue;
+            }
+            if (helpers.count(rhs.id()) && !definitions.count(rhs.id()))
+            {
+                definitions.emplace(rhs.id(), lhs);
+                continue;
+            }
+        }
+        constraints.push_back(c);
+    }
+
+    try
+    {
+        for (auto i = 0u; i < implVars.size(); ++i)
+            implementationSlots.push_back(compile(implVars[i]));
+        for (auto i = 0u; i < inpVars.size(); ++i)
+            inputSlots.push_back(compile(inpVars[i]));
+        failureSlot = compile(z3::mk_and(constraints) && !corrExpr);
+        compiled = true;
+    }
+    catch (const Unsupported &)
+    {
+        program.clear();
+    }
+
+    slots.clear();
+    definitions.clear();
+    variables.clear();
+    values.resize(program.size() * lanes);
+
+    // single bits are packed 64 per word iff the whole program works on single bits
+    packed = compiled && isPackable();
+
+    // constants do not change between evaluations
+    for (auto i = 0u; i < program.size(); ++i)
+    {
+        if (program[i].kind == Z3_OP_BNUM)
+            std::fill_n(lane(i), lanes, packed && program[i].value ? ~uint64_t{0} : program[i].value);
+    }
+}
+
+unsigned Simulator::append(const Instruction & ins)
+{
+    program.push_back(ins);
+    return static_cast<unsigned>(program.size() - 1);
+}
+
+uint64_t * Simulator::lane(unsigned slot) { return &values[slot * lanes]; }
+
+unsigned Simulator::compile(const z3::expr & e)
+{
+    auto it = slots.find(e.id());
+    if (it != slots.end())
+        return it->second;
+
+    if (!e.is_app())
+        throw Unsupported{};
+
+    Instruction ins{};
+    ins.width = widthOf(e.get_sort());
+    auto d = e.decl();
+    ins.kind = d.decl_kind();
+
+    if (ins.kind == Z3_OP_UNINTERPRETED)
+    {
+        if (e.num_args() != 0)
+            throw Unsupported{};
+
+        auto def = definitions.find(e.id());
+        if (def != definitions.end())
+        {
+            // a helper evaluates to its definition
+            if (!defining.insert(e.id()).second || widthOf(def->second.get_sort()) != ins.width)
+                throw Unsupported{};
+            auto slot = compile(def->second);
+            defining.erase(e.id());
+            return slots[e.id()] = slot;
+        }
+
+        // any other free symbol has no value
+        if (!variables.count(e.id()))
+            throw Unsupported{};
+    }
+    else if (ins.kind == Z3_OP_BNUM || ins.kind == Z3_OP_TRUE || ins.kind == Z3_OP_FALSE ||
+             ((ins.kind == Z3_OP_AND || ins.kind == Z3_OP_OR) && e.num_args() == 0))
+    {
+        uint64_t v = ins.kind == Z3_OP_TRUE || ins.kind == Z3_OP_AND;
+        if (ins.kind == Z3_OP_BNUM && !e.is_numeral_u64(v))
+            throw Unsupported{};
+        ins.kind = Z3_OP_BNUM;
+        ins.value = v;
+    }
+    else
+    {
+        switch (ins.kind)
+        {
+            case Z3_OP_EXTRACT:
+                ins.high = e.hi();
+                ins.low = e.lo();
+                break;
+            case Z3_OP_SIGN_EXT:
+            case Z3_OP_ZERO_EXT:
+            case Z3_OP_ROTATE_LEFT:
+            case Z3_OP_ROTATE_RIGHT:
+            case Z3_OP_REPEAT:
+                ins.low = static_cast<unsigned>(Z3_get_decl_int_parameter(e.ctx(), d, 0));
+                break;
+            case Z3_OP_EQ: case Z3_OP_DISTINCT: case Z3_OP_ITE: case Z3_OP_AND: case Z3_OP_OR: case Z3_OP_IFF:
+            case Z3_OP_XOR: case Z3_OP_NOT: case Z3_OP_IMPLIES:
+            case Z3_OP_BADD: case Z3_OP_BSUB: case Z3_OP_BMUL: case Z3_OP_BNEG:
+            case Z3_OP_BAND: case Z3_OP_BOR: case Z3_OP_BXOR: case Z3_OP_BNOT:
+            case Z3_OP_BNAND: case Z3_OP_BNOR: case Z3_OP_BXNOR:
+            case Z3_OP_ULEQ: case Z3_OP_SLEQ: case Z3_OP_UGEQ: case Z3_OP_SGEQ:
+            case Z3_OP_ULT: case Z3_OP_SLT: case Z3_OP_UGT: case Z3_OP_SGT:
+            case Z3_OP_CONCAT: case Z3_OP_BSHL: case Z3_OP_BLSHR: case Z3_OP_BASHR:
+            case Z3_OP_BUDIV: case Z3_OP_BUDIV_I: case Z3_OP_BUREM: case Z3_OP_BUREM_I:
+            case Z3_OP_BCOMP: case Z3_OP_BREDAND: case Z3_OP_BREDOR:
+                break;
+            default:
+                throw Unsupported{};
+        }
+
+        for (auto i = 0u; i < e.num_args(); ++i)
+            ins.args.push_back(compile(e.arg(i)));
+    }
+
+    auto slot = append(ins);
+    slots.emplace(e.id(), slot);
+    return slot;
+}
+
+void Simulator::evaluate()
+{
+    const auto n = lanes;
+    for (auto s = 0u; s < program.size(); ++s)
+    {
+        const auto & ins = program[s];
+        if (ins.kind == Z3_OP_UNINTERPRETED || ins.kind == Z3_OP_BNUM)
+            continue;
+
+        auto r = lane(s);
+        const auto m = mask(ins.width);
+        const uint64_t * a = ins.args.empty() ? nullptr : lane(ins.args[0]);
+        const uint64_t * b = ins.args.size() < 2 ? nullptr : lane(ins.args[1]);
+        // width of the first operand, relevant for comparisons and shifts
+        const auto w = ins.args.empty() ? 0u : program[ins.args[0]].width;
+        const auto am = mask(w);
+
+        switch (ins.kind)
+        {
+            case Z3_OP_AND: case Z3_OP_BAND:
+            case Z3_OP_OR:  case Z3_OP_BOR:
+            case Z3_OP_XOR: case Z3_OP_BXOR:
+            case Z3_OP_BADD: case Z3_OP_BSUB: case Z3_OP_BMUL:
+                std::copy_n(a, n, r);
+                for (auto k = 1u; k < ins.args.size(); ++k)
+                {
+                    const uint64_t * o = lane(ins.args[k]);
+                    switch (ins.kind)
+                    {
+                        case Z3_OP_AND: case Z3_OP_BAND: for (size_t i = 0; i < n; ++i) r[i] &= o[i]; break;
+                        case Z3_OP_OR:  case Z3_OP_BOR:  for (size_t i = 0; i < n; ++i) r[i] |= o[i]; break;
+                        case Z3_OP_XOR: case Z3_OP_BXOR: for (size_t i = 0; i < n; ++i) r[i] ^= o[i]; break;
+                        case Z3_OP_BADD: for (size_t i = 0; i < n; ++i) r[i] = (r[i] + o[i]) & m; break;
+                        case Z3_OP_BSUB: for (size_t i = 0; i < n; ++i) r[i] = (r[i] - o[i]) & m; break;
+                        default:         for (size_t i = 0; i < n; ++i) r[i] = (r[i] * o[i]) & m; break;
+                    }
+                }
+                break;
+            case Z3_OP_CONCAT:
+                std::copy_n(a, n, r);
+                for (auto k = 1u; k < ins.args.size(); ++k)
+                {
+                    const uint64_t * o = lane(ins.args[k]);
+                    const auto shift = program[ins.args[k]].width;
+                    for (size_t i = 0; i < n; ++i) r[i] = r[i] << shift | o[i];
+                }
+                break;
+            case Z3_OP_NOT:     for (size_t i = 0; i < n; ++i) r[i] = a[i] ^ 1; break;
+            case Z3_OP_BNOT:    for (size_t i = 0; i < n; ++i) r[i] = ~a[i] & m; break;
+            case Z3_OP_BNEG:    for (size_t i = 0; i < n; ++i) r[i] = (0 - a[i]) & m; break;
+            case Z3_OP_BNAND:   for (size_t i = 0; i < n; ++i) r[i] = ~(a[i] & b[i]) & m; break;
+            case Z3_OP_BNOR:    for (size_t i = 0; i < n; ++i) r[i] = ~(a[i] | b[i]) & m; break;
+            case Z3_OP_BXNOR:   for (size_t i = 0; i < n; ++i) r[i] = ~(a[i] ^ b[i]) & m; break;
+            case Z3_OP_IMPLIES: for (size_t i = 0; i < n; ++i) r[i] = (a[i] ^ 1) | b[i]; break;
+            case Z3_OP_EQ: case Z3_OP_IFF: case Z3_OP_BCOMP:
+                for (size_t i = 0; i < n; ++i) r[i] = a[i] == b[i];
+                break;
+            case Z3_OP_DISTINCT:
+                std::fill_n(r, n, 1);
+                for (auto x = 0u; x < ins.args.size(); ++x)
+                {
+                    for (auto y = x + 1; y < ins.args.size(); ++y)
+                    {
+                        const uint64_t * p = lane(ins.args[x]), * q = lane(ins.args[y]);
+                        for (size_t i = 0; i < n; ++i) r[i] &= p[i] != q[i];
+                    }
+                }
+                break;
+            case Z3_OP_ITE:
+            {
+                const uint64_t * c = lane(ins.args[2]);
+                b = lane(ins.args[1]);
+                for (size_t i = 0; i < n; ++i) r[i] = a[i] ? b[i] : c[i];
+                break;
+            }
+            case Z3_OP_ULEQ: for (size_t i = 0; i < n; ++i) r[i] = a[i] <= b[i]; break;
+            case Z3_OP_UGEQ: for (size_t i = 0; i < n; ++i) r[i] = a[i] >= b[i]; break;
+            case Z3_OP_ULT:  for (size_t i = 0; i < n; ++i) r[i] = a[i] < b[i]; break;
+            case Z3_OP_UGT:  for (size_t i = 0; i < n; ++i) r[i] = a[i] > b[i]; break;
+            case Z3_OP_SLEQ: for (size_t i = 0; i < n; ++i) r[i] = signExtend(a[i], w) <= signExtend(b[i], w); break;
+            case Z3_OP_SGEQ: for (size_t i = 0; i < n; ++i) r[i] = signExtend(a[i], w) >= signExtend(b[i], w); break;
+            case Z3_OP_SLT:  for (size_t i = 0; i < n; ++i) r[i] = signExtend(a[i], w) < signExtend(b[i], w); break;
+            case Z3_OP_SGT:  for (size_t i = 0; i < n; ++i) r[i] = signExtend(a[i], w) > signExtend(b[i], w); break;
+            case Z3_OP_EXTRACT:
+                for (size_t i = 0; i < n; ++i) r[i] = a[i] >> ins.low & m;
+                break;
+            case Z3_OP_ZERO_EXT:
+                std::copy_n(a, n, r);
+                break;
+            case Z3_OP_SIGN_EXT:
+                for (size_t i = 0; i < n; ++i) r[i] = static_cast<uint64_t>(signExtend(a[i], w)) & m;
+                break;
+            case Z3_OP_REPEAT:
+                std::copy_n(a, n, r);
+                for (auto k = 1u; k < ins.low; ++k)
+                    for (size_t i = 0; i < n; ++i) r[i] = r[i] << w | a[i];
+                break;
+            case Z3_OP_ROTATE_LEFT:
+            case Z3_OP_ROTATE_RIGHT:
+            {
+                auto k = ins.low % w;
+                if (ins.kind == Z3_OP_ROTATE_RIGHT)
+                    k = (w - k) % w;
+                if (k == 0)
+                    std::copy_n(a, n, r);
+                else
+                    for (size_t i = 0; i < n; ++i) r[i] = (a[i] << k | a[i] >> (w - k)) & m;
+                break;
+            }
+            case Z3_OP_BSHL:
+                for (size_t i = 0; i < n; ++i) r[i] = b[i] >= w ? 0 : a[i] << b[i] & m;
+                break;
+            case Z3_OP_BLSHR:
+                for (size_t i = 0; i < n; ++i) r[i] = b[i] >= w ? 0 : a[i] >> b[i];
+                break;
+            case Z3_OP_BASHR:
+                for (size_t i = 0; i < n; ++i)
+                    r[i] = static_cast<uint64_t>(signExtend(a[i], w) >> std::min<uint64_t>(b[i], 63)) & m;
+                break;
+            case Z3_OP_BUDIV: case Z3_OP_BUDIV_I:
+                for (size_t i = 0; i < n; ++i) r[i] = b[i] ? a[i] / b[i] : m;
+                break;
+            case Z3_OP_BUREM: case Z3_OP_BUREM_I:
+                for (size_t i = 0; i < n; ++i) r[i] = b[i] ? a[i] % b[i] : a[i];
+                break;
+            case Z3_OP_BREDAND: for (size_t i = 0; i < n; ++i) r[i] = a[i] == am; break;
+            case Z3_OP_BREDOR:  for (size_t i = 0; i < n; ++i) r[i] = a[i] != 0; break;
+            default:
+                break;
+        }
+    }
+}
+
+bool Simulator::isCompiled() const { return compiled; }
+
+size_t Simulator::getLanes() const { return lanes; }
+
+void Simulator::setImplementation(const std::vector<z3::expr> & valuation)
+{
+    for (auto i = 0u; i < implementationSlots.size() && i < valuation.size(); ++i)
+    {
+        uint64_t v = 0;
+        if (valuation[i].is_bool())
+            v = valuation[i].is_true();
+        else
+            valuation[i].is_numeral_u64(v);
+        std::fill_n(lane(implementationSlots[i]), lanes, packed && v ? ~uint64_t{0} : v);
+    }
+}
+
+void Simulator::evaluatePacked()
+{
+    const auto n = lanes;
+    for (auto s = 0u; s < program.size(); ++s)
+    {
+        const auto & ins = program[s];
+        if (ins.kind == Z3_OP_UNINTERPRETED || ins.kind == Z3_OP_BNUM)
+            continue;
+
+        auto r = lane(s);
+        const uint64_t * a = lane(ins.args[0]);
+        const uint64_t * b = ins.args.size() < 2 ? nullptr : lane(ins.args[1]);
+
+        switch (ins.kind)
+        {
+            case Z3_OP_AND: case Z3_OP_BAND: case Z3_OP_BMUL:
+            case Z3_OP_OR:  case Z3_OP_BOR:
+            case Z3_OP_XOR: case Z3_OP_BXOR: case Z3_OP_BADD: case Z3_OP_BSUB:
+                std::copy_n(a, n, r);
+                for (auto k = 1u; k < ins.args.size(); ++k)
+                {
+                    const uint64_t * o = lane(ins.args[k]);
+                    switch (ins.kind)
+                    {
+                        case Z3_OP_AND: case Z3_OP_BAND: case Z3_OP_BMUL:
+                            for (size_t i = 0; i < n; ++i) r[i] &= o[i];
+                            break;
+                        case Z3_OP_OR: case Z3_OP_BOR:
+                            for (size_t i = 0; i < n; ++i) r[i] |= o[i];
+                            break;
+                        default:
+                            for (size_t i = 0; i < n; ++i) r[i] ^= o[i];
+                            break;
+                    }
+                }
+                break;
+            case Z3_OP_NOT: case Z3_OP_BNOT:
+                for (size_t i = 0; i < n; ++i) r[i] = ~a[i];
+                break;
+            case Z3_OP_BNAND:   for (size_t i = 0; i < n; ++i) r[i] = ~(a[i] & b[i]); break;
+            case Z3_OP_BNOR:    for (size_t i = 0; i < n; ++i) r[i] = ~(a[i] | b[i]); break;
+            case Z3_OP_BXNOR:
+            case Z3_OP_EQ: case Z3_OP_IFF: case Z3_OP_BCOMP:
+                for (size_t i = 0; i < n; ++i) r[i] = ~(a[i] ^ b[i]);
+                break;
+            case Z3_OP_DISTINCT:
+                if (ins.args.size() == 2)
+                    for (size_t i = 0; i < n; ++i) r[i] = a[i] ^ b[i];
+                else // more than two single bits cannot be pairwise distinct
+                    std::fill_n(r, n, 0);
+                break;
+            case Z3_OP_IMPLIES: for (size_t i = 0; i < n; ++i) r[i] = ~a[i] | b[i]; break;
+            case Z3_OP_ITE:
+            {
+                const uint64_t * c = lane(ins.args[2]);
+                for (size_t i = 0; i < n; ++i) r[i] = (a[i] & b[i]) | (~a[i] & c[i]);
+                break;
+            }
+            default: // single bit extractions, extensions by zero bits, negation and reductions are the identity
+                std::copy_n(a, n, r);
+                break;
+        }
+    }
+}
+
+bool Simulator::isPackable() const
+{
+    for (const auto & ins : program)
+    {
+        if (ins.width != 1)
+            return false;
+        for (auto arg : ins.args)
+        {
+            if (program[arg].width != 1)
+                return false;
+        }
+
+        switch (ins.kind)
+        {
+            case Z3_OP_UNINTERPRETED: case Z3_OP_BNUM:
+            case Z3_OP_AND: case Z3_OP_OR: case Z3_OP_XOR: case Z3_OP_NOT: case Z3_OP_IMPLIES:
+            case Z3_OP_EQ: case Z3_OP_IFF: case Z3_OP_ITE: case Z3_OP_DISTINCT:
+            case Z3_OP_BAND: case Z3_OP_BOR: case Z3_OP_BXOR: case Z3_OP_BNOT:
+            case Z3_OP_BNAND: case Z3_OP_BNOR: case Z3_OP_BXNOR: case Z3_OP_BCOMP:
+            case Z3_OP_BADD: case Z3_OP_BSUB: case Z3_OP_BMUL: case Z3_OP_BNEG:
+            case Z3_OP_BREDAND: case Z3_OP_BREDOR:
+            case Z3_OP_EXTRACT: case Z3_OP_ZERO_EXT: case Z3_OP_SIGN_EXT:
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+size_t Simulator::getSamples() const { return packed ? lanes * 64 : lanes; }
+
+uint64_t Simulator::sample(unsigned slot, size_t index)
+{
+    return packed ? lane(slot)[index / 64] >> (index % 64) & 1 : lane(slot)[index];
+}
+
+void Simulator::collect(size_t count, size_t maxFailures, std::vector<z3::model> & failures)
+{
+    std::set<std::vector<uint64_t>> seen{};
+    for (size_t i = 0; i < count && failures.size() < maxFailures; ++i)
+    {
+        if (!sample(failureSlot, i))
+            continue;
+
+        std::vector<uint64_t> inputs{};
+        for (auto slot : inputSlots)
+            inputs.push_back(sample(slot, i));
+        if (!seen.insert(inputs).second)
+            continue;
+
+        auto & ctx = inputVariables.ctx();
+        failures.emplace_back(ctx);
+        for (auto k = 0u; k < inputVariables.size(); ++k)
+        {
+            auto var = inputVariables[k];
+            auto decl = var.decl();
+            auto value = var.is_bool() ? ctx.bool_val(inputs[k] != 0)
+                                       : ctx.bv_val(inputs[k], var.get_sort().bv_size());
+            failures.back().add_const_interp(decl, value);
+        }
+    }
+}
+
+std::vector<z3::model> Simulator::falsify(size_t maxFailures)
+{
+    std::vector<z3::model> failures{};
+    if (!compiled)
+        return failures;
+
+    for (auto slot : inputSlots)
+    {
+        auto r = lane(slot);
+        const auto m = packed ? ~uint64_t{0} : mask(program[slot].width);
+        for (size_t i = 0; i < lanes; ++i)
+            r[i] = random() & m;
+    }
+
+    packed ? evaluatePacked() : evaluate();
+    collect(getSamples(), maxFailures, failures);
+
+    return failures;
+}
+
+bool Simulator::isEnumerable(size_t maxInputs) const
+{
+    if (!compiled || inputSlots.size() > std::min(maxInputs, size_t{63}))
+        return false;
+    for (auto slot : inputSlots)
+    {
+        if (program[slot].width != 1)
+            return false;
+    }
+    return true;
+}
+
+std::vector<z3::model> Simulator::exhaust(size_t maxFailures)
+{
+    std::vector<z3::model> failures{};
+    const uint64_t minterms = uint64_t{1} << inputSlots.size();
+
+    // truth tables of the first six variables within a word of 64 minterms
+    static const uint64_t patterns[] = {0xAAAAAAAAAAAAAAAA, 0xCCCCCCCCCCCCCCCC, 0xF0F0F0F0F0F0F0F0,
+                                        0xFF00FF00FF00FF00, 0xFFFF0000FFFF0000, 0xFFFFFFFF00000000};
+
+    for (uint64_t base = 0; base < minterms && failures.size() < maxFailures; base += getSamples())
+    {
+        for (auto k = 0u; k < inputSlots.size(); ++k)
+        {
+            auto r = lane(inputSlots[k]);
+            for (size_t i = 0; i < lanes; ++i)
+            {
+                if (!packed)
+                    r[i] = (base + i) >> k & 1;
+                else if (k < 6)
+                    r[i] = patterns[k];
+                else
+                    r[i] = (base + i * 64) >> k & 1 ? ~uint64_t{0} : 0;
+            }
+        }
+
+        packed ? evaluatePacked() : evaluate();
+        collect(std::min<uint64_t>(getSamples(), minterms - base), maxFailures, failures);
+    }
+
+    return failures;
+}
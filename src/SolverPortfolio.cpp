@@ -0,0 +1,338 @@
+//
+// Created by marcel on 16.10.26.
+//
+
+#include "SolverPortfolio.h"
+#include "SolverProfile.h"
+#include <thread>
+#include <condition_variable>
+#include <algorithm>
+#include <chrono>
+
+// ************************************************************
+// ******************* Worker *********************************
+// ************************************************************
+
+SolverPortfolio::Worker::Worker(const std::string & tactic, unsigned seed)
+        :
+        context{},
+        solver{context},
+        tactic{tactic},
+        seed{seed}
+{
+    reset();
+}
+
+void SolverPortfolio::Worker::reset()
+{
+    timeout = 0;
+    assertions.clear();
+    scopes.clear();
+    rebuild();
+}
+
+void SolverPortfolio::Worker::rebuild()
+{
+    solver = SolverConfiguration{tactic, {}}.makeSolver(context);
+    z3::params p{context};
+    p.set("random_seed", seed);
+    if (timeout)
+        p.set("timeout", timeout);
+    solver.set(p);
+
+    auto scope = scopes.cbegin();
+    for (auto i = 0u; i <= assertions.size(); ++i)
+    {
+        for (; scope != scopes.cend() && *scope == i; ++scope)
+            solver.push();
+        if (i < assertions.size())
+            solver.add(assertions[i]);
+    }
+}
+
+
+// ************************************************************
+// ******************* SolverPortfolio ************************
+// ************************************************************
+
+SolverPortfolio::SolverPortfolio(size_t size, const std::vector<std::string> & tactics)
+        :
+        workers{},
+        winner{0}
+{
+    for (auto i = 0u; i < std::max(size, size_t{1}); ++i)
+    {
+        const std::string tactic = tactics.empty() ? "" : tactics[i % tactics.size()];
+        workers.emplace_back(new Worker(tactic, i));
+    }
+    winner = workers.size();
+}
+
+void SolverPortfolio::add(const z3::expr & e)
+{
+    for (auto & w : workers)
+    {
+        w->assertions.emplace_back(w->context, Z3_translate(e.ctx(), e, w->context));
+        w->solver.add(w->assertions.back());
+    }
+}
+
+void SolverPortfolio::reset()
+{
+    for (auto & w : workers)
+        w->reset();
+    winner = workers.size();
+}
+
+void SolverPortfolio::push()
+{
+    for (auto & w : workers)
+    {
+        w->scopes.push_back(w->assertions.size());
+        w->solver.push();
+    }
+}
+
+void SolverPortfolio::pop()
+{
+    for (auto & w : workers)
+    {
+        w->assertions.erase(w->assertions.begin() + static_cast<long>(w->scopes.back()), w->assertions.end());
+        w->scopes.pop_back();
+        w->solver.pop();
+    }
+}
+
+z3::check_result SolverPortfolio::check()
+{
+    winner = workers.size();
+
+    if (workers.size() == 1)
+    {
+        auto r = z3::unknown;
+        try
+        {
+            r = workers.front()->solver.check();
+        }
+        catch (const z3::exception &) {}
+
+        if (r != z3::unknown)
+            winner = 0;
+        else
+        {
+            clearInterrupts();
+            workers.front()->rebuild();
+        }
+        return r;
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<z3::check_result> results(workers.size(), z3::unknown);
+    std::vector<bool> done(workers.size(), false);
+    size_t finished = 0;
+
+    std::vector<std::thread> threads;
+    for (auto i = 0u; i < workers.size(); ++i)
+    {
+        threads.emplace_back([&, i]
+        {
+            auto r = z3::unknown;
+            try
+            {
+                r = workers[i]->solver.check();
+            }
+            catch (const z3::exception &) {}
+
+            std::lock_guard<std::mutex> lock{mutex};
+            results[i] = r;
+            done[i] = true;
+            ++finished;
+            if (r != z3::unknown && winner == workers.size())
+                winner = i;
+            cv.notify_all();
+        });
+    }
+
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        cv.wait(lock, [&] { return winner != workers.size() || finished == workers.size(); });
+
+        // a worker might not have entered its check yet when interrupted, hence repeat until all have finished
+        while (finished != workers.size())
+        {
+            for (auto i = 0u; i < workers.size(); ++i)
+            {
+                if (!done[i])
+                    workers[i]->context.interrupt();
+            }
+            cv.wait_for(lock, std::chrono::milliseconds(1));
+        }
+    }
+
+    for (auto & t : threads)
+        t.join();
+
+    clearInterrupts();
+    for (auto i = 0u; i < workers.size(); ++i)
+    {
+        if (results[i] == z3::unknown)
+            workers[i]->rebuild();
+    }
+
+    return winner == workers.size() ? z3::unknown : results[winner];
+}
+
+z3::check_result SolverPortfolio::checkCubes(const std::vector<z3::expr> & splits)
+{
+    winner = workers.size();
+
+    // the literals are translated on this thread, the workers build their cubes from their own copies
+    std::vector<std::vector<z3::expr>> literals(workers.size());
+    for (auto i = 0u; i < workers.size(); ++i)
+    {
+        for (const auto & l : splits)
+            literals[i].emplace_back(workers[i]->context, Z3_translate(l.ctx(), l, workers[i]->context));
+    }
+
+    const size_t cubes = size_t{1} << splits.size();
+    std::atomic<size_t> next{0};
+    std::atomic<bool> found{false};
+    std::mutex mutex;
+    bool incomplete = false;
+    std::vector<bool> done(workers.size(), false), cut(workers.size(), false);
+    long runtime = 0;
+    size_t solved = 0, checked = 0;
+
+    std::vector<std::thread> threads;
+    for (auto i = 0u; i < workers.size(); ++i)
+    {
+        threads.emplace_back([&, i]
+        {
+            auto & w = *workers[i];
+            size_t cube;
+            while (!found && !interrupted && (cube = next++) < cubes)
+            {
+                z3::expr_vector assumptions{w.context};
+                for (auto j = 0u; j < literals[i].size(); ++j)
+                    assumptions.push_back(cube >> j & 1u ? literals[i][j] : !literals[i][j]);
+
+                auto start = std::chrono::steady_clock::now();
+                auto r = z3::unknown;
+                try
+                {
+                    r = w.solver.check(assumptions);
+                }
+                catch (const z3::exception &) {}
+                auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                                start).count();
+
+                std::lock_guard<std::mutex> lock{mutex};
+                ++checked;
+                if (r == z3::unknown)
+                    cut[i] = true;
+                if (r == z3::sat && !found)
+                {
+                    winner = i;
+                    found = true;
+                }
+                else if (r == z3::unknown && !found)
+                    incomplete = true;
+                else if (r == z3::unsat)
+                {
+                    runtime += us;
+                    ++solved;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock{mutex};
+            done[i] = true;
+        });
+    }
+
+    // as in check(), interrupt the remaining workers repeatedly once a counter example was found
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (std::find(done.begin(), done.end(), false) == done.end())
+                break;
+            if (found)
+            {
+                for (auto i = 0u; i < workers.size(); ++i)
+                {
+                    if (!done[i] && i != winner)
+                        workers[i]->context.interrupt();
+                }
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    for (auto & t : threads)
+        t.join();
+
+    if (std::find(cut.begin(), cut.end(), true) != cut.end())
+    {
+        clearInterrupts();
+        for (auto i = 0u; i < workers.size(); ++i)
+        {
+            if (cut[i])
+                workers[i]->rebuild();
+        }
+    }
+    else if (found || interrupted)
+        clearInterrupts();
+    cubeRuntime = solved ? runtime / static_cast<long>(solved) : 0;
+    checkedCubes = checked;
+
+    if (found)
+        return z3::sat;
+    return incomplete || interrupted || next < cubes ? z3::unknown : z3::unsat;
+}
+
+long SolverPortfolio::getCubeRuntime() const { return cubeRuntime; }
+
+size_t SolverPortfolio::getCheckedCubes() const { return checkedCubes; }
+
+z3::model SolverPortfolio::getModel(z3::context & ctx) const
+{
+    z3::model m = workers[winner]->solver.get_model();
+    return z3::model(m, ctx, z3::model::translate());
+}
+
+z3::stats SolverPortfolio::statistics() const
+{
+    return workers[winner == workers.size() ? 0 : winner]->solver.statistics();
+}
+
+size_t SolverPortfolio::assertionCount() const { return workers.front()->solver.assertions().size(); }
+
+void SolverPortfolio::setTimeout(unsigned ms)
+{
+    for (auto & w : workers)
+    {
+        w->timeout = ms;
+        z3::params p{w->context};
+        p.set("timeout", ms);
+        w->solver.set(p);
+    }
+}
+
+void SolverPortfolio::interrupt()
+{
+    std::lock_guard<std::mutex> lock{interruptMutex};
+    interrupted = true;
+    for (auto & w : workers)
+        w->context.interrupt();
+}
+
+void SolverPortfolio::clearInterrupts()
+{
+    // running an empty solver resets the canceled state
+    for (auto & w : workers)
+        z3::solver{w->context, z3::solver::simple()}.check();
+    interrupted = false;
+}
+
+size_t SolverPortfolio::size() const { return workers.size(); }
@@ -0,0 +1,167 @@
+//
+// Created by marcel on 16.10.26.
+//
+
+#include "SolverProfile.h"
+#include <sstream>
+#include <cstdlib>
+#include <cerrno>
+
+namespace
+{
+    /**
+     * Header line identifying profile files.
+     */
+    const std::string PROFILE_MAGIC = "cegis-profile 1";
+
+    /**
+     * Name of every role in profile files, indexed by the role.
+     */
+    const char * const ROLE_NAMES[] = {"implementation", "counter-example"};
+
+    /**
+     * Sets a parameter given as string with the most specific type its value can be read as.
+     */
+    void setParameter(z3::params & p, const std::string & name, const std::string & value)
+    {
+        if (value == "true" || value == "false")
+        {
+            p.set(name.c_str(), value == "true");
+            return;
+        }
+
+        char * end = nullptr;
+        errno = 0;
+        const auto u = std::strtoul(value.c_str(), &end, 10);
+        if (!value.empty() && value.front() != '-' && !*end && !errno && u <= 0xffffffffu)
+        {
+            p.set(name.c_str(), static_cast<unsigned>(u));
+            return;
+        }
+
+        const auto d = std::strtod(value.c_str(), &end);
+        if (!value.empty() && !*end)
+        {
+            p.set(name.c_str(), d);
+            return;
+        }
+
+        p.set(name.c_str(), p.ctx().str_symbol(value.c_str()));
+    }
+}
+
+
+// ************************************************************
+// ******************* SolverConfiguration ********************
+// ************************************************************
+
+z3::solver SolverConfiguration::makeSolver(z3::context & ctx) const
+{
+    std::stringstream pipeline{tactic};
+    std::string name;
+    std::vector<z3::tactic> tactics;
+    while (std::getline(pipeline, name, ';'))
+    {
+        if (!name.empty())
+            tactics.emplace_back(ctx, name.c_str());
+    }
+
+    if (tactics.empty())
+    {
+        z3::solver s{ctx};
+        configure(s);
+        return s;
+    }
+
+    z3::tactic t = tactics.front();
+    for (auto i = 1u; i < tactics.size(); ++i)
+        t = t & tactics[i];
+
+    auto s = t.mk_solver();
+    configure(s);
+    return s;
+}
+
+void SolverConfiguration::configure(z3::solver & s) const
+{
+    if (parameters.empty())
+        return;
+
+    z3::params p{s.ctx()};
+    for (const auto & param : parameters)
+        setParameter(p, param.first, param.second);
+    s.set(p);
+}
+
+std::string SolverConfiguration::describe() const
+{
+    std::string d = tactic.empty() ? "default" : tactic;
+    for (const auto & param : parameters)
+        d += " " + param.first + "=" + param.second;
+    return d;
+}
+
+
+// ************************************************************
+// ******************* SolverProfile **************************
+// ************************************************************
+
+SolverConfiguration & SolverProfile::operator[](SolverRole role)
+{
+    return role == SolverRole::IMPLEMENTATION ? implementation : counterExample;
+}
+
+const SolverConfiguration & SolverProfile::operator[](SolverRole role) const
+{
+    return role == SolverRole::IMPLEMENTATION ? implementation : counterExample;
+}
+
+void SolverProfile::save(std::ostream & out) const
+{
+    out << PROFILE_MAGIC << '\n';
+    for (auto role : {SolverRole::IMPLEMENTATION, SolverRole::COUNTER_EXAMPLE})
+    {
+        const auto & config = (*this)[role];
+        const auto name = ROLE_NAMES[static_cast<int>(role)];
+        if (!config.tactic.empty())
+            out << name << " tactic " << config.tactic << '\n';
+        for (const auto & param : config.parameters)
+            out << name << " param " << param.first << ' ' << param.second << '\n';
+    }
+}
+
+SolverProfile SolverProfile::load(std::istream & in)
+{
+    std::string line;
+    if (!std::getline(in, line) || line != PROFILE_MAGIC)
+        throw z3::exception("not a solver profile");
+
+    SolverProfile profile{};
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line.front() == '#')
+            continue;
+
+        std::stringstream fields{line};
+        std::string role, kind, name, value;
+        fields >> role >> kind >> name;
+        std::getline(fields >> std::ws, value);
+
+        SolverConfiguration * config;
+        if (role == ROLE_NAMES[0])
+            config = &profile.implementation;
+        else if (role == ROLE_NAMES[1])
+            config = &profile.counterExample;
+        else
+            throw z3::exception(("unknown solver role in profile: " + role).c_str());
+
+        if (kind == "tactic" && value.empty())
+            config->tactic = name;
+        else if (kind == "param" && !value.empty())
+            config->parameters.emplace_back(name, value);
+        else
+            throw z3::exception(("malformed profile line: " + line).c_str());
+    }
+
+    return profile;
+}
@@ -0,0 +1,217 @@
+//
+// Created by marcel on 16.10.26.
+//
+
+#include "TaskFile.h"
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <unordered_set>
+#include <cctype>
+
+namespace
+{
+    /**
+     * Splits an SMT-LIB2 text into parentheses and atoms. Comments are dropped, string literals and quoted symbols
+     * are kept verbatim as single atoms.
+     */
+    std::vector<std::string> tokenize(const std::string & text)
+    {
+        std::vector<std::string> tokens{};
+        for (size_t i = 0; i < text.size();)
+        {
+            const char c = text[i];
+            if (std::isspace(static_cast<unsigned char>(c)))
+                ++i;
+            else if (c == ';')
+            {
+                while (i < text.size() && text[i] != '\n')
+                    ++i;
+            }
+            else if (c == '(' || c == ')')
+            {
+                tokens.emplace_back(1, c);
+                ++i;
+            }
+            else if (c == '"' || c == '|')
+            {
+                auto end = i + 1;
+                for (; end < text.size(); ++end)
+                {
+                    if (text[end] != c)
+                        continue;
+                    // "" escapes a quote within a string literal
+                    if (c == '"' && end + 1 < text.size() && text[end + 1] == '"')
+                        ++end;
+                    else
+                        break;
+                }
+                if (end >= text.size())
+                    throw z3::exception("unterminated string literal or quoted symbol");
+                tokens.push_back(text.substr(i, end + 1 - i));
+                i = end + 1;
+            }
+            else
+            {
+                auto end = i;
+                while (end < text.size() && !std::isspace(static_cast<unsigned char>(text[end])) &&
+                       text[end] != '(' && text[end] != ')' && text[end] != ';' && text[end] != '"' && text[end] != '|')
+                    ++end;
+                tokens.push_back(text.substr(i, end - i));
+                i = end;
+            }
+        }
+        return tokens;
+    }
+
+    /**
+     * Returns the given symbol or string literal without its quotes.
+     */
+    std::string unquote(const std::string & atom)
+    {
+        if (atom.size() >= 2 && (atom.front() == '|' || atom.front() == '"'))
+            return atom.substr(1, atom.size() - 2);
+        return atom;
+    }
+
+    /**
+     * Appends the atoms of the list starting at tokens[i] to names. Throws iff tokens[i] does not start a flat list.
+     */
+    void readSymbols(const std::vector<std::string> & tokens, size_t i, const std::string & keyword,
+                     std::vector<std::string> & names)
+    {
+        if (i >= tokens.size() || tokens[i] != "(")
+            throw z3::exception((keyword + " expects a list of symbols").c_str());
+        for (++i; i < tokens.size() && tokens[i] != ")"; ++i)
+        {
+            if (tokens[i] == "(")
+                throw z3::exception((keyword + " expects a list of symbols").c_str());
+            names.push_back(tokens[i]);
+        }
+    }
+}
+
+TaskFile::TaskFile(z3::context & ctx, const std::string & text, const std::string & defaultName)
+        :
+        name{defaultName},
+        implementationVariables{ctx},
+        inputVariables{ctx},
+        helperVariables{ctx},
+        implementationExpression{ctx},
+        behavioralExpression{ctx},
+        correctnessExpression{ctx}
+{
+    // commands understood by Z3's parser that contribute to the task
+    static const std::unordered_set<std::string> forwarded
+    {
+        "assert", "declare-const", "declare-fun", "declare-sort", "declare-datatype", "declare-datatypes",
+        "define-fun", "define-fun-rec", "define-funs-rec", "define-sort", "set-logic"
+    };
+
+    std::vector<std::string> roles[3];
+    bool defined[3] = {false, false, false};
+    const std::string parts[3] = {"implementation", "behavior", "correctness"};
+
+    // cut the text into its top-level commands
+    std::string script{};
+    const auto tokens = tokenize(text);
+    for (size_t i = 0; i < tokens.size();)
+    {
+        if (tokens[i] != "(" || i + 1 >= tokens.size())
+            throw z3::exception(("unexpected '" + tokens[i] + "' outside of a command").c_str());
+
+        auto end = i;
+        for (auto depth = 0; end < tokens.size(); ++end)
+        {
+            depth += tokens[end] == "(" ? 1 : tokens[end] == ")" ? -1 : 0;
+            if (!depth)
+                break;
+        }
+        if (end == tokens.size())
+            throw z3::exception("unbalanced parentheses");
+
+        const auto & head = tokens[i + 1];
+        if (head == "set-info" && i + 3 < end)
+        {
+            const auto & keyword = tokens[i + 2];
+            if (keyword == ":name")
+                name = unquote(tokens[i + 3]);
+            else if (keyword == ":cegis-implementation-variables")
+                readSymbols(tokens, i + 3, keyword, roles[0]);
+            else if (keyword == ":cegis-input-variables")
+                readSymbols(tokens, i + 3, keyword, roles[1]);
+            else if (keyword == ":cegis-helper-variables")
+                readSymbols(tokens, i + 3, keyword, roles[2]);
+        }
+        else if (forwarded.count(head))
+        {
+            if (head == "define-fun" && i + 2 < end)
+            {
+                for (auto p = 0u; p < 3; ++p)
+                    defined[p] |= tokens[i + 2] == parts[p];
+            }
+            for (auto j = i; j <= end; ++j)
+                script += tokens[j] + ' ';
+            script += '\n';
+        }
+
+        i = end + 1;
+    }
+
+    if (!defined[2])
+        throw z3::exception("the task does not define correctness");
+
+    // every variable is probed by a trivial equation to obtain its expression from the parser
+    size_t probes = 0;
+    for (const auto & role : roles)
+    {
+        for (const auto & v : role)
+            script += "(assert (= " + v + " " + v + "))\n";
+        probes += role.size();
+    }
+    for (auto p = 0u; p < 3; ++p)
+        script += "(assert " + (defined[p] ? parts[p] : std::string{"true"}) + ")\n";
+
+    const auto assertions = ctx.parse_string(script.c_str());
+    const auto plain = assertions.size() - probes - 3;
+
+    auto index = plain;
+    z3::expr_vector * vectors[3] = {&implementationVariables, &inputVariables, &helperVariables};
+    for (auto r = 0u; r < 3; ++r)
+    {
+        for (const auto & v : roles[r])
+        {
+            auto var = assertions[static_cast<int>(index++)].arg(0);
+            if (!var.is_const() || var.decl().decl_kind() != Z3_OP_UNINTERPRETED)
+                throw z3::exception((v + " is not a declared constant").c_str());
+            vectors[r]->push_back(var);
+        }
+    }
+
+    implementationExpression = assertions[static_cast<int>(index++)];
+    behavioralExpression     = assertions[static_cast<int>(index++)];
+    correctnessExpression    = assertions[static_cast<int>(index)];
+    for (auto i = 0u; i < plain; ++i)
+        behavioralExpression = behavioralExpression && assertions[static_cast<int>(i)];
+}
+
+TaskFile TaskFile::load(z3::context & ctx, const std::string & path)
+{
+    std::ifstream file{path};
+    if (!file)
+        throw z3::exception(("cannot read " + path).c_str());
+    std::stringstream text{};
+    text << file.rdbuf();
+
+    auto base = path.substr(path.find_last_of('/') == std::string::npos ? 0 : path.find_last_of('/') + 1);
+    return TaskFile{ctx, text.str(), base.substr(0, base.find_last_of('.'))};
+}
+
+std::unique_ptr<CEGISHandler> TaskFile::makeHandler() const
+{
+    std::unique_ptr<CEGISHandler> handler{new CEGISHandler(&implementationVariables.ctx(), implementationVariables,
+                                                           inputVariables, helperVariables, implementationExpression,
+                                                           behavioralExpression, correctnessExpression)};
+    handler->setName(name);
+    return handler;
+}
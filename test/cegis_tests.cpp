@@ -0,0 +1,973 @@
+//
+// Created by marcel on 16.10.26.
+//
+
+#include "CEGIS.h"
+#include "CEGISScheduler.h"
+#include <algorithm>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+#include <map>
+#include <set>
+
+/**
+ * Behavior tests of the CEGIS routine. Every result is checked independently of the handler, e.g. a returned
+ * implementation is verified on a fresh solver. Usage: cegis_tests NAME [cegis_worker path]
+ */
+
+/**
+ * A synthesis task split in the parts expected by CEGISHandler.
+ */
+struct Task {
+    z3::expr_vector impl, inp, hlp;
+    z3::expr implExpr, behavExpr, corrExpr;
+
+    explicit Task(z3::context & c)
+            :
+            impl{c}, inp{c}, hlp{c},
+            implExpr{c.bool_val(true)}, behavExpr{c.bool_val(true)}, corrExpr{c.bool_val(true)}
+    {}
+
+    std::unique_ptr<CEGISHandler> handler(z3::context & c) const
+    {
+        return std::unique_ptr<CEGISHandler>(new CEGISHandler(&c, impl, inp, hlp, implExpr, behavExpr, corrExpr));
+    }
+};
+
+/**
+ * Ripple-carry adder of width w whose sum and carry functions of every bit are looked up in unknown 8-bit truth
+ * tables, as in the benchmark suite.
+ */
+static Task adder(z3::context & c, unsigned w)
+{
+    Task task{c};
+    auto x = c.bv_const("x", w), y = c.bv_const("y", w);
+    task.inp.push_back(x);
+    task.inp.push_back(y);
+
+    auto lut = [&](const z3::expr & table, const z3::expr & index)
+    {
+        return z3::lshr(table, z3::zext(index, 5)).extract(0, 0);
+    };
+
+    z3::expr_vector behavCons{c};
+    auto carry = c.bv_const("c0", 1);
+    task.hlp.push_back(carry);
+    behavCons.push_back(carry == c.bv_val(0, 1));
+
+    z3::expr sum{c};
+    for (auto i = 0u; i < w; ++i)
+    {
+        const std::string id = std::to_string(i);
+        auto ls = c.bv_const(("ls" + id).c_str(), 8), lc = c.bv_const(("lc" + id).c_str(), 8);
+        task.impl.push_back(ls);
+        task.impl.push_back(lc);
+
+        auto s = c.bv_const(("s" + id).c_str(), 1), next = c.bv_const(("c" + std::to_string(i + 1)).c_str(), 1);
+        task.hlp.push_back(s);
+        task.hlp.push_back(next);
+
+        auto index = z3::concat(z3::concat(x.extract(i, i), y.extract(i, i)), carry);
+        behavCons.push_back(s == lut(ls, index));
+        behavCons.push_back(next == lut(lc, index));
+
+        sum = i == 0 ? s : z3::concat(s, sum);
+        carry = next;
+    }
+
+    task.behavExpr = z3::mk_and(behavCons);
+    task.corrExpr = sum == x + y;
+    return task;
+}
+
+/**
+ * Boolean function (a & b) | (c ^ d) of four single bit inputs looked up in an unknown 16-bit truth table.
+ */
+static Task lookup(z3::context & c)
+{
+    Task task{c};
+    auto a = c.bv_const("a", 1), b = c.bv_const("b", 1), cin = c.bv_const("c", 1), d = c.bv_const("d", 1);
+    for (const auto & i : {a, b, cin, d})
+        task.inp.push_back(i);
+
+    auto table = c.bv_const("table", 16), out = c.bv_const("out", 1);
+    task.impl.push_back(table);
+    task.hlp.push_back(out);
+
+    auto index = z3::concat(z3::concat(a, b), z3::concat(cin, d));
+    task.behavExpr = out == z3::lshr(table, z3::zext(index, 12)).extract(0, 0);
+    task.corrExpr = out == ((a & b) | (cin ^ d));
+    return task;
+}
+
+/**
+ * Multiplication by an unknown 8-bit constant k that has to agree with multiplication by 3 on the lower 4 bits of the
+ * product, i.e. all k = 3 mod 16 are correct.
+ */
+static Task scale(z3::context & c)
+{
+    Task task{c};
+    auto x = c.bv_const("x", 8), k = c.bv_const("k", 8);
+    task.inp.push_back(x);
+    task.impl.push_back(k);
+    task.corrExpr = (x * k).extract(3, 0) == (x * 3).extract(3, 0);
+    return task;
+}
+
+/**
+ * Key k of 80 bits that has to mask two interchangeable 80-bit inputs like a fixed constant does, as far as their sum
+ * is concerned. Only inputs with a nonzero most significant word matter, hence every counter example spans two words.
+ */
+static Task wide(z3::context & c)
+{
+    Task task{c};
+    auto x = c.bv_const("x", 80), y = c.bv_const("y", 80), k = c.bv_const("k", 80);
+    task.inp.push_back(x);
+    task.inp.push_back(y);
+    task.impl.push_back(k);
+
+    auto mask = z3::concat(c.bv_val(0xA5C3, 16), c.bv_val(static_cast<uint64_t>(0x0123456789ABCDEF), 64));
+    task.corrExpr = z3::implies(x.extract(79, 64) != 0 && y.extract(79, 64) != 0,
+                                (x ^ k) + (y ^ k) == (x ^ mask) + (y ^ mask));
+    return task;
+}
+
+/**
+ * Configures both solvers as bit-blasting SAT solvers.
+ */
+static SolverProfile bitBlastingProfile()
+{
+    SolverProfile profile{};
+    profile.implementation = {"simplify;bit-blast;sat", {{"sat.restart", "luby"}}};
+    profile.counterExample = {"simplify;bit-blast;sat", {}};
+    return profile;
+}
+
+/**
+ * Throws iff the condition does not hold.
+ */
+static void expect(bool condition, const std::string & what)
+{
+    if (!condition)
+        throw std::runtime_error(what);
+}
+
+/**
+ * Checks the implementation of a result on a fresh solver: it has to satisfy the implementation constraints and
+ * no input may violate the correctness constraints.
+ */
+static bool isCorrect(z3::context & c, const Task & task, const CEGISHandler::CEGISResult & result)
+{
+    z3::expr_vector valuation{c};
+    for (auto i = 0u; i < task.impl.size(); ++i)
+        valuation.push_back(task.impl[i] == result.getValuation(task.impl[i], true));
+
+    z3::solver constraints{c};
+    constraints.add(z3::mk_and(valuation) && task.implExpr);
+    if (constraints.check() != z3::sat)
+        return false;
+
+    z3::solver verifier{c};
+    verifier.add(z3::mk_and(valuation) && task.behavExpr && !task.corrExpr);
+    return verifier.check() == z3::unsat;
+}
+
+/**
+ * Checks that the counter example values of a result are the ones the handler saves, i.e. the ones actually recorded,
+ * in the same order. Values are compared in the decimal form of the counter example file.
+ */
+static void expectSaved(CEGISHandler & handler, const Task & task, const CEGISHandler::CEGISResult & result)
+{
+    const std::string file = "expect-saved.cex";
+    expect(handler.saveCounterExamples(file), "counter examples were not saved");
+    std::vector<std::string> lines;
+    {
+        std::ifstream in{file};
+        for (std::string line; std::getline(in, line);)
+            lines.push_back(line);
+    }
+    std::remove(file.c_str());
+
+    // header and one line per input
+    const auto header = task.inp.size() + 1;
+    expect(lines.size() == header + result.getNumberOfCounterExamples(), "result holds other counter examples");
+    for (auto ce = 0u; ce < result.getNumberOfCounterExamples(); ++ce)
+    {
+        std::istringstream fields{lines[header + ce]};
+        std::string field;
+        for (auto i = 0u; i < task.inp.size(); ++i)
+        {
+            std::getline(fields, field, '\t');
+            expect(Z3_get_numeral_string(task.inp.ctx(), result.getCounterExampleValue(ce, i)) == field,
+                   "counter example value of the result differs from the recorded one");
+        }
+    }
+}
+
+// ************************************************************
+// ******************* Solving ********************************
+// ************************************************************
+
+/**
+ * Inspection of a result, e.g. to confirm that a configured feature was at work.
+ */
+using Observation = std::function<void(const CEGISHandler::CEGISResult &)>;
+
+/**
+ * Counts the iteration records of a result that match the given predicate.
+ */
+static size_t countIterations(const CEGISHandler::CEGISResult & result,
+                              const std::function<bool(const CEGISHandler::IterationRecord &)> & matches)
+{
+    const auto & iterations = result.getIterations();
+    return static_cast<size_t>(std::count_if(iterations.begin(), iterations.end(), matches));
+}
+
+/**
+ * Solves the adder and checks the implementation. Then replaces its correctness by multiplication, which can not be
+ * looked up by the same sketch, and expects a fresh handler to prove it unrealizable. Each handler is configured
+ * with knowledge of its task, e.g. to declare symmetries among its inputs. If given, observe inspects the result of
+ * the adder, whose iterations are recorded then.
+ */
+static void solve(const std::function<void(CEGISHandler &, const Task &)> & configure, const Observation & observe = {})
+{
+    z3::context c;
+    auto task = adder(c, 4);
+    auto handler = task.handler(c);
+    configure(*handler, task);
+    handler->setStatistics(static_cast<bool>(observe));
+    auto result = handler->CEGISRoutine();
+    expect(result.getStopReason() == CEGISHandler::StopReason::SOLVED, "adder was not solved");
+    expect(isCorrect(c, task, result), "adder was solved by an incorrect implementation");
+    if (observe)
+        observe(result);
+
+    task.corrExpr = task.corrExpr.arg(0) == task.inp[0] * task.inp[1];
+    handler = task.handler(c);
+    configure(*handler, task);
+    expect(handler->CEGISRoutine().getStopReason() == CEGISHandler::StopReason::UNREALIZABLE,
+           "multiplier was not proven unrealizable");
+}
+
+/**
+ * Runs the solving test above with a configuration independent of the task.
+ */
+static void solve(const std::function<void(CEGISHandler &)> & configure, const Observation & observe = {})
+{
+    solve([&](CEGISHandler & h, const Task &) { configure(h); }, observe);
+}
+
+/**
+ * Solves the lookup task, whose four single bit inputs fit into a truth table. The only correct table has to be found,
+ * and once its most significant entry is fixed to 0, the task has to be proven unrealizable. Every implementation has
+ * to be verified by the given means.
+ */
+static void solveLookup(const std::function<void(CEGISHandler &)> & configure, CEGISHandler::Verifier verifier)
+{
+    auto verifiedBy = [&](const CEGISHandler::CEGISResult & result)
+    {
+        auto other = [&](const CEGISHandler::IterationRecord & it)
+        {
+            return it.verifier != verifier && it.verifier != CEGISHandler::Verifier::NONE;
+        };
+        expect(!result.getIterations().empty() && countIterations(result, other) == 0,
+               "lookup was verified by unexpected means");
+    };
+
+    z3::context c;
+    auto task = lookup(c);
+    auto handler = task.handler(c);
+    configure(*handler);
+    handler->setStatistics(true);
+    auto result = handler->CEGISRoutine();
+    expect(result.getStopReason() == CEGISHandler::StopReason::SOLVED, "lookup was not solved");
+    expect(isCorrect(c, task, result), "lookup was solved by an incorrect table");
+    verifiedBy(result);
+
+    // (1 & 1) | (1 ^ 1) is 1
+    task.implExpr = task.impl[0].extract(15, 15) == c.bv_val(0, 1);
+    handler = task.handler(c);
+    configure(*handler);
+    handler->setStatistics(true);
+    auto unrealizable = handler->CEGISRoutine();
+    expect(unrealizable.getStopReason() == CEGISHandler::StopReason::UNREALIZABLE,
+           "lookup with a wrong entry was not proven unrealizable");
+    verifiedBy(unrealizable);
+}
+
+// ************************************************************
+// ******************* Enumerating ****************************
+// ************************************************************
+
+/**
+ * Returns all correct values of the single 8-bit implementation variable of the given task, determined by verifying
+ * each of them on a fresh solver.
+ */
+static std::set<uint64_t> correctValues(z3::context & c, const Task & task)
+{
+    std::set<uint64_t> values;
+    for (auto v = 0u; v < 256; ++v)
+    {
+        z3::solver verifier{c};
+        verifier.add(task.impl[0] == c.bv_val(v, 8) && task.implExpr && task.behavExpr && !task.corrExpr);
+        if (verifier.check() == z3::unsat)
+            values.insert(v);
+    }
+    return values;
+}
+
+/**
+ * Enumerates the implementations of the scale task, first the first 5 of them, then all. They have to be distinct
+ * and correct, and all have to be exactly the correct values.
+ */
+static void enumerate()
+{
+    z3::context c;
+    const auto task = scale(c);
+    const auto expected = correctValues(c, task);
+
+    for (auto k : {size_t{5}, size_t{0}})
+    {
+        std::set<uint64_t> values;
+        auto handler = task.handler(c);
+        const auto n = handler->enumerateImplementations([&](const CEGISHandler::CEGISResult & result)
+        {
+            expect(isCorrect(c, task, result), "an incorrect implementation was enumerated");
+            expect(values.insert(result.getValuation(task.impl[0], true).get_numeral_uint64()).second,
+                   "an implementation was enumerated twice");
+            return true;
+        }, k);
+
+        expect(n == values.size(), "the number of enumerated implementations is wrong");
+        expect(k ? n == k : values == expected, "not all implementations were enumerated");
+    }
+}
+
+/**
+ * Minimizes the cost k ^ 0x5A over the implementations of the scale task with the given strategy. Every reported
+ * implementation has to be correct and cheaper than the one before, and the last one has to be optimal among the
+ * correct values.
+ */
+static void minimize(CEGISHandler::CostSearch search)
+{
+    z3::context c;
+    const auto task = scale(c);
+    const auto cost = task.impl[0] ^ c.bv_val(0x5A, 8);
+
+    uint64_t optimum = 256;
+    for (auto v : correctValues(c, task))
+        optimum = std::min(optimum, v ^ 0x5Au);
+
+    uint64_t best = 256;
+    auto handler = task.handler(c);
+    const auto reason = handler->minimize(cost, [&](const CEGISHandler::CEGISResult & result)
+    {
+        expect(isCorrect(c, task, result), "an incorrect implementation was reported");
+        const auto value = result.getValuation(cost, true).get_numeral_uint64();
+        expect(value < best, "a reported implementation is not cheaper than the one before");
+        best = value;
+        return true;
+    }, search);
+
+    expect(reason == CEGISHandler::StopReason::SOLVED, "minimization did not finish");
+    expect(best == optimum, "the last reported implementation is not optimal");
+}
+
+// ************************************************************
+// ******************* Statistics *****************************
+// ************************************************************
+
+/**
+ * Collects per-iteration records of the scaling task under a name that needs escaping in JSON and exports them. Every
+ * record has to appear in both formats, and the records have to account for all counter examples.
+ */
+static void exportIterations()
+{
+    const std::string name = "quoted \"scale\" \\ with\ttab";
+    z3::context c;
+    auto handler = scale(c).handler(c);
+    handler->setName(name);
+    handler->setStatistics(true);
+    auto result = handler->CEGISRoutine();
+    expect(result.getStopReason() == CEGISHandler::StopReason::SOLVED, "scaling was not solved");
+
+    const auto & iterations = result.getIterations();
+    expect(!iterations.empty(), "no iteration was recorded");
+    size_t counterExamples = 0;
+    for (const auto & it : iterations)
+        counterExamples += it.counterExamples;
+    expect(counterExamples == result.getNumberOfCounterExamples(), "records miss counter examples");
+
+    std::ostringstream csv;
+    result.printIterations(csv);
+    std::istringstream rows{csv.str()};
+    size_t n = 0;
+    for (std::string row; std::getline(rows, row); ++n)
+    {
+        expect(row.compare(0, name.size() + 2, name + ", ") == 0, "CSV row does not start with the name");
+        expect(std::count(row.begin(), row.end(), ',') == 18, "CSV row does not hold 19 fields");
+    }
+    expect(n == iterations.size(), "CSV does not hold one row per iteration");
+
+    std::ostringstream json;
+    result.printIterations(json, true);
+    const std::string escaped = "{\"benchmark\": \"quoted \\\"scale\\\" \\\\ with\\u0009tab\", ";
+    n = 0;
+    for (auto at = json.str().find(escaped); at != std::string::npos; at = json.str().find(escaped, at + 1))
+        ++n;
+    expect(n == iterations.size(), "JSON does not hold one object with the escaped name per iteration");
+    expect(json.str().find('\t') == std::string::npos, "JSON holds an unescaped control character");
+}
+
+/**
+ * Solves the scaling task without collecting statistics, which must not leave any record behind.
+ */
+static void withoutStatistics()
+{
+    z3::context c;
+    auto result = scale(c).handler(c)->CEGISRoutine();
+    expect(result.getStopReason() == CEGISHandler::StopReason::SOLVED, "scaling was not solved");
+    expect(result.getIterations().empty(), "iterations were recorded without statistics");
+
+    std::ostringstream csv, json;
+    result.printIterations(csv);
+    result.printIterations(json, true);
+    expect(csv.str().empty(), "CSV holds rows without statistics");
+    expect(json.str() == "[\n]\n", "JSON holds objects without statistics");
+}
+
+// ************************************************************
+// ******************* Scheduling *****************************
+// ************************************************************
+
+/**
+ * Schedules a task whose handler can not be created ahead of several adders. The failing task has to be reported as
+ * ERROR while the pool keeps solving all others correctly.
+ */
+static void scheduleFailingTask()
+{
+    CEGISScheduler scheduler{2};
+    scheduler.submit([](z3::context &) -> std::unique_ptr<CEGISHandler>
+    {
+        throw std::runtime_error("task file not found");
+    });
+    for (auto i = 0u; i < 4; ++i)
+        scheduler.submit([](z3::context & c) { return adder(c, 3).handler(c); });
+
+    size_t errors = 0, solved = 0;
+    scheduler.run([&](const CEGISHandler::CEGISResult & result)
+    {
+        if (result.getStopReason() == CEGISHandler::StopReason::ERROR)
+        {
+            ++errors;
+            return;
+        }
+
+        expect(result.getStopReason() == CEGISHandler::StopReason::SOLVED, "scheduled adder was not solved");
+        // the result lives in the context of its worker, which is known by the values of its counter examples
+        expect(result.getNumberOfCounterExamples() > 0, "scheduled adder was solved without counter examples");
+        auto & c = result.getCounterExampleValue(0, 0).ctx();
+        expect(isCorrect(c, adder(c, 3), result), "scheduled adder was solved by an incorrect implementation");
+        ++solved;
+    });
+
+    expect(errors == 1, "failing task was not reported as error");
+    expect(solved == 4, "pool did not complete the remaining tasks");
+}
+
+// ************************************************************
+// ******************* Worker processes ***********************
+// ************************************************************
+
+/**
+ * Verifies the scale task in a worker process that dies whenever it is asked for the model of a satisfiable check.
+ * The lost counter example must neither be made up nor the verdict be accepted.
+ */
+static void loseModel(const std::string & worker)
+{
+    z3::context c;
+    auto task = scale(c);
+    auto handler = task.handler(c);
+    handler->setVerificationProcesses(1, worker);
+    handler->setTimeout(10000);
+    auto result = handler->CEGISRoutine();
+    expect(result.getStopReason() == CEGISHandler::StopReason::UNKNOWN, "a verdict without model was accepted");
+    expect(result.getNumberOfCounterExamples() == 0, "a counter example was made up for a lost model");
+}
+
+// ************************************************************
+// ******************* Persisting *****************************
+// ************************************************************
+
+/**
+ * Solves a task on inputs wider than 64 bits, whose counter examples span several words of the store, and also
+ * records their orbits. Their values have to survive the result, a reload and the move to a new store on an edit.
+ */
+static void wideInputs()
+{
+    const std::string file = "wide-inputs.cex";
+    z3::context c;
+    auto task = wide(c);
+    auto handler = task.handler(c);
+    handler->setSymmetryGroups({task.inp});
+    auto result = handler->CEGISRoutine();
+    expect(result.getStopReason() == CEGISHandler::StopReason::SOLVED, "wide task was not solved");
+    expect(isCorrect(c, task, result), "wide task was solved by an incorrect implementation");
+    const auto n = result.getNumberOfCounterExamples();
+    expect(n > 1, "wide task was solved without orbits");
+    for (auto i = 0u; i < n; ++i)
+    {
+        for (auto j = 0u; j < task.inp.size(); ++j)
+        {
+            expect(result.getCounterExampleValue(i, j).extract(79, 64).simplify().get_numeral_uint64() != 0,
+                   "wide counter example lost its most significant word");
+        }
+    }
+    expectSaved(*handler, task, result);
+
+    expect(handler->saveCounterExamples(file), "wide counter examples were not saved");
+    auto fresh = task.handler(c);
+    expect(fresh->loadCounterExamples(file, true) == n, "wide counter examples were not loaded");
+    auto loaded = fresh->CEGISRoutine();
+    for (auto i = 0u; i < n; ++i)
+    {
+        for (auto j = 0u; j < task.inp.size(); ++j)
+        {
+            expect(z3::eq(loaded.getCounterExampleValue(i, j), result.getCounterExampleValue(i, j)),
+                   "loaded wide counter example differs from the saved one");
+        }
+    }
+    std::remove(file.c_str());
+
+    // a premise on x alone still demands something of every counter example, hence all move to a new store
+    auto edited = task;
+    edited.corrExpr = z3::implies(task.inp[0].extract(79, 64) != 0, task.corrExpr.arg(1));
+    expect(handler->setCorrectness(edited.corrExpr) == n, "counter examples were dropped by the edit");
+    auto editedResult = handler->CEGISRoutine();
+    expect(editedResult.getStopReason() == CEGISHandler::StopReason::SOLVED, "edited wide task was not solved");
+    expect(isCorrect(c, edited, editedResult), "edited wide task was solved by an incorrect implementation");
+    for (auto i = 0u; i < n; ++i)
+    {
+        for (auto j = 0u; j < task.inp.size(); ++j)
+        {
+            expect(z3::eq(editedResult.getCounterExampleValue(i, j), result.getCounterExampleValue(i, j)),
+                   "wide counter example changed when moved to a new store");
+        }
+    }
+    expectSaved(*handler, edited, editedResult);
+}
+
+/**
+ * Saves the counter examples of a solved adder and loads them into fresh handlers. The same specification has to
+ * get all of them back with their values, continue from them and still be solved correctly. A related specification
+ * gets them only iff it does not insist on the same one. Malformed lines have to be skipped and reported.
+ */
+static void saveAndLoad()
+{
+    const std::string file = "save-load.cex";
+    z3::context c;
+    auto task = adder(c, 4);
+    auto handler = task.handler(c);
+    auto saved = handler->CEGISRoutine();
+    expect(handler->saveCounterExamples(file), "counter examples were not saved");
+    const auto n = saved.getNumberOfCounterExamples();
+
+    auto fresh = task.handler(c);
+    expect(fresh->loadCounterExamples(file, true) == n, "saved counter examples were not loaded");
+    auto result = fresh->CEGISRoutine();
+    expect(result.getStopReason() == CEGISHandler::StopReason::SOLVED, "adder was not solved after loading");
+    expect(isCorrect(c, task, result), "adder was solved by an incorrect implementation after loading");
+    expect(result.getNumberOfCounterExamples() >= n, "loaded counter examples were lost");
+    for (auto i = 0u; i < n; ++i)
+    {
+        for (auto j = 0u; j < task.inp.size(); ++j)
+        {
+            expect(z3::eq(result.getCounterExampleValue(i, j), saved.getCounterExampleValue(i, j)),
+                   "loaded counter example differs from the saved one");
+        }
+    }
+
+    auto related = task;
+    related.corrExpr = task.corrExpr.arg(0) == (task.inp[0] ^ task.inp[1]);
+    expect(related.handler(c)->loadCounterExamples(file, true) == 0, "foreign counter examples were loaded");
+    fresh = related.handler(c);
+    expect(fresh->loadCounterExamples(file) == n, "counter examples were not loaded into a related specification");
+    auto relatedResult = fresh->CEGISRoutine();
+    expect(relatedResult.getStopReason() == CEGISHandler::StopReason::SOLVED, "related specification was not solved");
+    expect(isCorrect(c, related, relatedResult), "related specification was solved by an incorrect implementation");
+
+    // a line lacking a value, a line with an undecodable value and a last line cut off by an interrupted run
+    {
+        std::ofstream out{file, std::ios::app};
+        out << "5\n" << "5\tfive\n" << "3\t1";
+    }
+    size_t skipped = 0;
+    expect(task.handler(c)->loadCounterExamples(file, true, &skipped) == n, "malformed lines were loaded");
+    expect(skipped == 3, "malformed lines were not reported");
+
+    std::remove(file.c_str());
+}
+
+// ************************************************************
+// ******************* Resuming *******************************
+// ************************************************************
+
+/**
+ * Resumes the routine under growing timeouts until it stops for another reason. The first runs are too short to
+ * finish, hence interrupts hit the solvers in the middle of their checks.
+ */
+static void resumeAfterTimeout(const std::function<void(CEGISHandler &)> & configure)
+{
+    z3::context c;
+    auto task = adder(c, 5);
+    auto handler = task.handler(c);
+    configure(*handler);
+
+    size_t timeouts = 0;
+    for (unsigned ms = 1; ; ms += 2)
+    {
+        expect(ms < 1000, "resumed runs did not finish");
+        handler->setTimeout(ms);
+        auto result = handler->CEGISRoutine();
+        if (result.getStopReason() == CEGISHandler::StopReason::TIMEOUT)
+        {
+            ++timeouts;
+            continue;
+        }
+
+        expect(timeouts > 0, "no run was interrupted");
+        expect(result.getStopReason() == CEGISHandler::StopReason::SOLVED, "resumed run did not solve the task");
+        expect(isCorrect(c, task, result), "resumed run returned an incorrect implementation");
+        expectSaved(*handler, task, result);
+        return;
+    }
+}
+
+/**
+ * Cancels the routine from another thread after a growing delay and resumes it until it stops for another reason.
+ */
+static void resumeAfterCancel(const std::function<void(CEGISHandler &)> & configure)
+{
+    z3::context c;
+    auto task = adder(c, 5);
+    auto handler = task.handler(c);
+    configure(*handler);
+
+    size_t cancellations = 0;
+    for (unsigned ms = 1; ; ms += 2)
+    {
+        expect(ms < 1000, "resumed runs did not finish");
+        std::thread canceller{[&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+            handler->cancel();
+        }};
+        auto result = handler->CEGISRoutine();
+        canceller.join();
+        if (result.getStopReason() == CEGISHandler::StopReason::CANCELLED)
+        {
+            ++cancellations;
+            continue;
+        }
+
+        expect(cancellations > 0, "no run was cancelled");
+        expect(result.getStopReason() == CEGISHandler::StopReason::SOLVED, "resumed run did not solve the task");
+        expect(isCorrect(c, task, result), "resumed run returned an incorrect implementation");
+        return;
+    }
+}
+
+// ************************************************************
+// ******************* Editing ********************************
+// ************************************************************
+
+/**
+ * Solves the adder, then edits its specification step by step. After every edit, the continued run has to stop for
+ * the same reason as a fresh handler on the edited task, and a found implementation has to be correct.
+ */
+static void editSpecification(const std::function<void(CEGISHandler &)> & configure)
+{
+    z3::context c;
+    auto task = adder(c, 4);
+    auto handler = task.handler(c);
+    configure(*handler);
+    expect(handler->CEGISRoutine().getStopReason() == CEGISHandler::StopReason::SOLVED, "adder was not solved");
+
+    auto compare = [&](const Task & edited, const std::string & what)
+    {
+        auto result = handler->CEGISRoutine();
+        auto fresh = edited.handler(c);
+        configure(*fresh);
+        auto expected = fresh->CEGISRoutine();
+        expect(result.getStopReason() == expected.getStopReason(), what + " differs from a fresh handler");
+        if (result.getStopReason() == CEGISHandler::StopReason::SOLVED)
+            expect(isCorrect(c, edited, result), what + " returned an incorrect implementation");
+    };
+
+    // xor can be looked up by the same sketch, multiplication cannot
+    const auto sum = task.corrExpr.arg(0), x = task.inp[0], y = task.inp[1];
+    for (const auto & corr : {sum == (x ^ y), sum == x * y, sum == x + y})
+    {
+        auto edited = task;
+        edited.corrExpr = corr;
+        handler->setCorrectness(corr);
+        compare(edited, "setCorrectness");
+    }
+
+    // the carry-in is 0, hence the sum of the least significant bit can not be looked up in an empty table
+    auto strengthened = task;
+    strengthened.implExpr = task.implExpr && task.impl[0] == c.bv_val(0, 8);
+    handler->strengthenImplementation(task.impl[0] == c.bv_val(0, 8));
+    compare(strengthened, "strengthenImplementation");
+}
+
+/**
+ * Solves the adder, then excludes its first counter example by a premise. All others are kept but renumbered, hence
+ * their instances have to be rebuilt under their new numbers for the continued run to stay correct.
+ */
+static void renumber()
+{
+    z3::context c;
+    auto task = adder(c, 4);
+    auto handler = task.handler(c);
+    auto result = handler->CEGISRoutine();
+    const auto n = result.getNumberOfCounterExamples();
+    expect(n > 1, "adder was solved by less than two counter examples");
+
+    auto edited = task;
+    const auto x = task.inp[0], y = task.inp[1];
+    edited.corrExpr = z3::implies(x != result.getCounterExampleValue(0, 0) || y != result.getCounterExampleValue(0, 1),
+                                  task.corrExpr);
+    expect(handler->setCorrectness(edited.corrExpr) == n - 1, "other than the first counter example were dropped");
+    auto editedResult = handler->CEGISRoutine();
+    expect(editedResult.getStopReason() == CEGISHandler::StopReason::SOLVED, "renumbered adder was not solved");
+    expect(isCorrect(c, edited, editedResult), "renumbered adder was solved by an incorrect implementation");
+    for (auto i = 0u; i + 1 < n; ++i)
+    {
+        for (auto j = 0u; j < task.inp.size(); ++j)
+        {
+            expect(z3::eq(editedResult.getCounterExampleValue(i, j), result.getCounterExampleValue(i + 1, j)),
+                   "kept counter example was not moved to the preceding number");
+        }
+    }
+    expectSaved(*handler, edited, editedResult);
+}
+
+/**
+ * Solves the adder, switches both solvers to another configuration and edits the specification. The live solvers
+ * have to be replaced without losing the counter examples, and every run has to stay correct. Finally, a verifier
+ * that can not decide anything has to take over and hand back again.
+ */
+static void reconfigure()
+{
+    z3::context c;
+    auto task = adder(c, 4);
+    auto handler = task.handler(c);
+    const auto n = handler->CEGISRoutine().getNumberOfCounterExamples();
+
+    handler->setSolverProfile(bitBlastingProfile());
+    auto result = handler->CEGISRoutine();
+    expect(result.getStopReason() == CEGISHandler::StopReason::SOLVED, "reconfigured adder was not solved");
+    expect(isCorrect(c, task, result), "reconfigured adder was solved by an incorrect implementation");
+    expect(result.getNumberOfCounterExamples() >= n, "reconfiguration lost counter examples");
+
+    auto edited = task;
+    edited.corrExpr = task.corrExpr.arg(0) == (task.inp[0] ^ task.inp[1]);
+    handler->setCorrectness(edited.corrExpr);
+    auto editedResult = handler->CEGISRoutine();
+    expect(editedResult.getStopReason() == CEGISHandler::StopReason::SOLVED, "edited xor was not solved");
+    expect(isCorrect(c, edited, editedResult), "edited xor was solved by an incorrect implementation");
+
+    // a verifier whose tactic always fails can not decide anything, hence a run stops iff it was put in charge
+    handler->setSolverConfiguration(SolverRole::COUNTER_EXAMPLE, {"fail", {}});
+    expect(handler->CEGISRoutine().getStopReason() == CEGISHandler::StopReason::UNKNOWN,
+           "reconfigured verifier was not used");
+    handler->setSolverConfiguration(SolverRole::COUNTER_EXAMPLE, {});
+    auto restoredResult = handler->CEGISRoutine();
+    expect(restoredResult.getStopReason() == CEGISHandler::StopReason::SOLVED, "restored verifier was not used");
+    expect(isCorrect(c, edited, restoredResult), "restored xor was solved by an incorrect implementation");
+}
+
+/**
+ * Configures either solver of a fresh handler with a tactic that always fails. The adder must not be decided then,
+ * which shows that the configuration is in charge.
+ */
+static void failingProfile()
+{
+    z3::context c;
+    auto task = adder(c, 4);
+    for (auto role : {SolverRole::IMPLEMENTATION, SolverRole::COUNTER_EXAMPLE})
+    {
+        auto handler = task.handler(c);
+        handler->setSolverConfiguration(role, {"fail", {}});
+        expect(handler->CEGISRoutine().getStopReason() == CEGISHandler::StopReason::UNKNOWN,
+               "configured tactic was not used");
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    const std::string worker = argc > 2 ? argv[2] : "cegis_worker";
+    const std::function<void(CEGISHandler &)> plain = [](CEGISHandler &) {};
+    const std::function<void(CEGISHandler &)> portfolio = [](CEGISHandler & h) { h.setCounterExamplePortfolio(3); };
+    const std::function<void(CEGISHandler &)> pipeline = [](CEGISHandler & h) { h.setPipelining(true); };
+    const std::function<void(CEGISHandler &)> batch = [](CEGISHandler & h) { h.setBatchSize(4); };
+    const Observation batched = [](const CEGISHandler::CEGISResult & r)
+    {
+        auto several = [](const CEGISHandler::IterationRecord & it) { return it.counterExamples > 1; };
+        expect(countIterations(r, several) > 0, "no iteration found several counter examples");
+    };
+    const std::function<void(CEGISHandler &)> portfolios = [](CEGISHandler & h)
+    {
+        h.setImplementationPortfolio(2);
+        h.setCounterExamplePortfolio(2);
+    };
+    const std::function<void(CEGISHandler &)> pruning = [](CEGISHandler & h)
+    {
+        h.setPruning(2, 4);
+        h.setPreprocessing(true);
+    };
+    const Observation pruned = [](const CEGISHandler::CEGISResult & r)
+    {
+        auto retiring = [](const CEGISHandler::IterationRecord & it) { return it.retired > 0; };
+        expect(countIterations(r, retiring) > 0, "no counter example was retired");
+    };
+    const std::function<void(CEGISHandler &)> generalization = [](CEGISHandler & h) { h.setCoreGeneralization(true); };
+    const Observation generalized = [](const CEGISHandler::CEGISResult & r)
+    {
+        auto generalizing = [](const CEGISHandler::IterationRecord & it) { return it.generalizations > 0; };
+        expect(countIterations(r, generalizing) > 0, "no refutation was generalized");
+    };
+    const std::function<void(CEGISHandler &)> simulation = [](CEGISHandler & h) { h.setSimulation(64); };
+    const Observation simulated = [](const CEGISHandler::CEGISResult & r)
+    {
+        auto falsified = [](const CEGISHandler::IterationRecord & it)
+        {
+            return it.verifier == CEGISHandler::Verifier::SIMULATION && it.counterExamples > 0;
+        };
+        expect(countIterations(r, falsified) > 0, "no implementation was falsified by simulation");
+    };
+    auto truthTables = [](size_t n) -> std::function<void(CEGISHandler &)>
+    {
+        return [n](CEGISHandler & h) { h.setTruthTableThreshold(n); };
+    };
+    const std::function<void(CEGISHandler &)> cubes = [](CEGISHandler & h) { h.setCubeSharding(2); };
+    const Observation sharded = [](const CEGISHandler::CEGISResult & r)
+    {
+        auto several = [](const CEGISHandler::IterationRecord & it)
+        {
+            return it.verifier == CEGISHandler::Verifier::CUBES && it.cubes > 1;
+        };
+        expect(countIterations(r, several) > 0, "no counter example search was sharded into several cubes");
+    };
+    const std::function<void(CEGISHandler &)> preprocessing = [](CEGISHandler & h) { h.setPreprocessing(true); };
+    // every helper of the adder is defined by an equation, hence only its two inputs remain to be relabeled
+    const Observation preprocessed = [](const CEGISHandler::CEGISResult & r)
+    {
+        auto helpers = [](const CEGISHandler::IterationRecord & it) { return it.relabeled != 2; };
+        expect(countIterations(r, helpers) == 0, "helpers were relabeled despite preprocessing");
+    };
+    const std::function<void(CEGISHandler &)> bitBlasting = [](CEGISHandler & h)
+    {
+        h.setSolverProfile(bitBlastingProfile());
+    };
+    // both operands of the adder and the multiplier are interchangeable
+    const std::function<void(CEGISHandler &, const Task &)> symmetric = [](CEGISHandler & h, const Task & task)
+    {
+        h.setSymmetryGroups({task.inp});
+    };
+    // orbits add counter examples beyond the ones found by the verifier
+    const Observation mirrored = [](const CEGISHandler::CEGISResult & r)
+    {
+        size_t found = 0;
+        for (const auto & it : r.getIterations())
+            found += it.counterExamples;
+        expect(r.getNumberOfCounterExamples() > found, "no orbit was instantiated");
+    };
+    // batches keep several counter examples pending while their refutation is generalized
+    const std::function<void(CEGISHandler &)> generalizing = [](CEGISHandler & h)
+    {
+        h.setBatchSize(4);
+        h.setCoreGeneralization(true);
+    };
+    const std::function<void(CEGISHandler &)> processes = [&](CEGISHandler & h)
+    {
+        h.setVerificationProcesses(2, worker);
+    };
+    // at least one implementation was verified by the given means
+    auto verifiedBy = [](CEGISHandler::Verifier verifier) -> Observation
+    {
+        return [verifier](const CEGISHandler::CEGISResult & r)
+        {
+            auto by = [&](const CEGISHandler::IterationRecord & it) { return it.verifier == verifier; };
+            expect(countIterations(r, by) > 0, "the configured verifier was not used");
+        };
+    };
+
+    const std::map<std::string, std::function<void()>> tests
+    {
+        {"solve",                     [&] { solve(plain); }},
+        {"solve-batch",               [&] { solve(batch, batched); }},
+        {"solve-portfolios",          [&] { solve(portfolios); }},
+        {"solve-pruning",             [&] { solve(pruning, pruned); }},
+        {"solve-generalization",      [&] { solve(generalization, generalized); }},
+        {"solve-simulation",          [&] { solve(simulation, simulated); }},
+        {"solve-truth-tables",        [&] { solveLookup(truthTables(4), CEGISHandler::Verifier::TRUTH_TABLES); }},
+        {"solve-tables-default",      [&] { solveLookup(plain, CEGISHandler::Verifier::TRUTH_TABLES); }},
+        {"solve-tables-disabled",     [&] { solveLookup(truthTables(0), CEGISHandler::Verifier::SOLVER); }},
+        {"solve-processes",           [&] { solve(processes, verifiedBy(CEGISHandler::Verifier::PROCESSES)); }},
+        {"solve-pipeline",            [&] { solve(pipeline, verifiedBy(CEGISHandler::Verifier::PIPELINE)); }},
+        {"solve-cubes",               [&] { solve(cubes, sharded); }},
+        {"solve-profile",             [&] { solve(bitBlasting); }},
+        {"solve-profile-failing",     [&] { failingProfile(); }},
+        {"solve-preprocessing",       [&] { solve(preprocessing, preprocessed); }},
+        {"solve-symmetry",            [&] { solve(symmetric, mirrored); }},
+        {"enumerate",                 [&] { enumerate(); }},
+        {"minimize-linear",           [&] { minimize(CEGISHandler::CostSearch::LINEAR); }},
+        {"minimize-binary",           [&] { minimize(CEGISHandler::CostSearch::BINARY); }},
+        {"statistics-export",         [&] { exportIterations(); }},
+        {"statistics-disabled",       [&] { withoutStatistics(); }},
+        {"schedule-error",            [&] { scheduleFailingTask(); }},
+        {"processes-lost-model",      [&] { loseModel(worker); }},
+        {"save-load",                 [&] { saveAndLoad(); }},
+        {"save-load-wide",            [&] { wideInputs(); }},
+        {"resume-timeout",            [&] { resumeAfterTimeout(plain); }},
+        {"resume-timeout-portfolio",  [&] { resumeAfterTimeout(portfolio); }},
+        {"resume-timeout-pipeline",   [&] { resumeAfterTimeout(pipeline); }},
+        {"resume-timeout-processes",  [&] { resumeAfterTimeout(processes); }},
+        {"resume-timeout-generalize", [&] { resumeAfterTimeout(generalizing); }},
+        {"resume-cancel",             [&] { resumeAfterCancel(plain); }},
+        {"resume-cancel-portfolio",   [&] { resumeAfterCancel(portfolio); }},
+        {"edit",                      [&] { editSpecification(plain); }},
+        {"edit-portfolios",           [&] { editSpecification(portfolios); }},
+        {"edit-profile",              [&] { editSpecification(bitBlasting); }},
+        {"edit-reconfigure",          [&] { reconfigure(); }},
+        {"edit-renumber",             [&] { renumber(); }},
+        {"edit-pruning",              [&] { editSpecification(pruning); }},
+        {"edit-processes",            [&] { editSpecification(processes); }}
+    };
+
+    auto test = argc > 1 ? tests.find(argv[1]) : tests.end();
+    if (test == tests.end())
+    {
+        std::cerr << "Usage: " << argv[0] << " NAME [cegis_worker path]" << std::endl << "Tests:";
+        for (const auto & t : tests)
+            std::cerr << ' ' << t.first;
+        std::cerr << std::endl;
+        return 2;
+    }
+
+    try
+    {
+        test->second();
+    }
+    catch (const std::exception & e)
+    {
+        std::cerr << test->first << ": " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
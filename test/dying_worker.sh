@@ -0,0 +1,15 @@
+#!/usr/bin/env bash
+#
+# Stand-in for cegis_worker that finds every formula satisfiable but dies when asked for the model, as a worker
+# exceeding its memory limit right after its check did.
+#
+
+echo ready
+while IFS=$'\t' read -r command argument; do
+    case "$command" in
+        assert) read -r -N "$argument" _; echo ok ;;
+        check)  echo sat ;;
+        model)  exit 3 ;;
+        *)      echo ok ;;
+    esac
+done
@@ -0,0 +1,27 @@
+//
+// Created by marcel on 16.10.26.
+//
+
+#include "ProcessPortfolio.h"
+#include <cstring>
+#include <cstdlib>
+
+/**
+ * Verification worker started by ProcessPortfolio. Speaks the portfolio's line protocol on its standard input and
+ * output. Usage: cegis_worker [--seed N] [--memory MEGABYTES]
+ */
+int main(int argc, char * argv[])
+{
+    unsigned seed = 0;
+    size_t megabytes = 0;
+    for (auto i = 1; i + 1 < argc; i += 2)
+    {
+        if (!std::strcmp(argv[i], "--seed"))
+            seed = static_cast<unsigned>(std::strtoul(argv[i + 1], nullptr, 10));
+        else if (!std::strcmp(argv[i], "--memory"))
+            megabytes = std::strtoul(argv[i + 1], nullptr, 10);
+    }
+
+    std::ios::sync_with_stdio(false);
+    return ProcessPortfolio::serve(std::cin, std::cout, seed, megabytes);
+}